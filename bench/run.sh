@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# Runs the benchmark programs in this directory and writes a report.
+# Every program is run in sequential mode (-s) and with each thread count
+# in THREADS, REPEAT times each, and the median of every measurement is kept.
+#
+# usage: run.sh <interpreter> <report base name>
+# writes <report base name>.csv and <report base name>.json
+#
+# The environment variables REPEAT, THREADS and BENCH (the programs to run,
+# by name) override the defaults.
+
+INTERPRETER=${1:-./build/interpreter}
+REPORT=${2:-./build/bench}
+REPEAT=${REPEAT:-5}
+THREADS=${THREADS:-"1 2 4 8"}
+DIR=$(dirname "$0")
+BENCH=${BENCH:-$(ls "$DIR" | sed -n 's/\.bench$//p')}
+TMP=${TMPDIR:-/tmp}/bench.$$
+
+median() {
+    sort -n | awk '{v[NR]=$1} END {if (NR%2) print v[(NR+1)/2]; else print int((v[NR/2]+v[NR/2+1])/2)}'
+}
+
+# run <program> <size> <flags>: prints the medians of wall time, cpu time and peak rss
+run() {
+    prelude=$(sed -n 's/^# prelude: //p' "$DIR/$1.bench")
+    i=0
+    : > "$TMP.runs"
+    while [ $i -lt "$REPEAT" ]; do
+	(if [ -n "$prelude" ]; then cat $prelude; fi; grep -v '^#' "$DIR/$1.bench" | sed "s/SIZE/$2/g"; echo "quit") |
+	    "$INTERPRETER" -r $3 2>&1 >/dev/null | sed -n 's/^usage //p' >> "$TMP.runs"
+	i=$((i+1))
+    done
+    wall=$(sed 's/.*wall_ns=\([0-9]*\).*/\1/' "$TMP.runs" | median)
+    cpu=$(sed 's/.*cpu_ns=\([0-9]*\).*/\1/' "$TMP.runs" | median)
+    rss=$(sed 's/.*maxrss_kb=\([0-9]*\).*/\1/' "$TMP.runs" | median)
+    echo "$wall $cpu $rss"
+}
+
+echo "program,size,threads,wall_ns,cpu_ns,maxrss_kb,speedup" > "$REPORT.csv"
+for program in $BENCH; do
+    for size in $(sed -n 's/^# sizes: //p' "$DIR/$program.bench"); do
+	set -- $(run "$program" "$size" -s)
+	base=$1
+	echo "$program,$size,0,$1,$2,$3,1.00" >> "$REPORT.csv"
+	echo "$program size $size sequential: $1 ns"
+	for threads in $THREADS; do
+	    set -- $(run "$program" "$size" "-t $threads")
+	    speedup=$(awk "BEGIN {printf \"%.2f\", $base / ($1 ? $1 : 1)}")
+	    echo "$program,$size,$threads,$1,$2,$3,$speedup" >> "$REPORT.csv"
+	    echo "$program size $size $threads threads: $1 ns, speedup $speedup"
+	done
+    done
+done
+rm -f "$TMP.runs"
+
+awk -F, 'NR > 1 {
+    printf "%s\n  {\"program\": \"%s\", \"size\": %s, \"threads\": %s, \"wall_ns\": %s, \"cpu_ns\": %s, \"maxrss_kb\": %s, \"speedup\": %s}", (NR > 2 ? "," : "["), $1, $2, $3, $4, $5, $6, $7
+} END { print (NR > 1 ? "\n]" : "[]") }' "$REPORT.csv" > "$REPORT.json"
+echo "Wrote $REPORT.csv and $REPORT.json"
@@ -1,5 +1,7 @@
 #include "structures.h"
 #include "parser.h"
+#include "hashcons.h"
+#include "libinterpreter.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <CUnit/Basic.h>
@@ -19,7 +21,9 @@ void testVAL(void)
 {
   FILE* in;
   in = fopen("./tests/testULTIMATE", "r");
-  SymbolIdent* it = parse(in, NULL);
+  Parser* parser = parserNew(in, NULL);
+  SymbolIdent* it = parse(parser);
+  parserFree(parser);
   CU_ASSERT(!strcmp(it->name, "sumlist")); //name of function
   CU_ASSERT(!strcmp(it->argNames->name, "x")); //name of arg to function
   CU_ASSERT(!strcmp(getCharVal(it->parseTree->value), "ite")); // name of first expression in function
@@ -32,6 +36,47 @@ void testVAL(void)
   CU_ASSERT(!strcmp(getCharVal(it->parseTree->argList->next->target->argList->next->target->argList->target->value), "tl"));
   CU_ASSERT(!strcmp(getCharVal(it->parseTree->argList->next->target->argList->next->target->argList->target->argList->target->value), "x"));
 }
+void testHASHCONS(void)
+{
+  hashConsing = 1;
+  ValList* tail1 = createListNode(createVal(ValueType_INT, 2), NULL);
+  ValList* tail2 = createListNode(createVal(ValueType_INT, 2), NULL);
+  CU_ASSERT(tail1 == tail2); // equal nodes are shared
+  ValList* list1 = createListNode(createVal(ValueType_LIST, (intptr_t) tail1), tail1);
+  ValList* list2 = createListNode(createVal(ValueType_LIST, (intptr_t) tail2), tail2);
+  CU_ASSERT(list1 == list2); // nested lists are shared as well
+  CU_ASSERT(getListsEqual(createVal(ValueType_LIST, (intptr_t) list1), createVal(ValueType_LIST, (intptr_t) list2)));
+  hashConsing = 0;
+  ValList* nested1 = createListNode(createVal(ValueType_LIST, (intptr_t) createListNode(createVal(ValueType_INT, 1), NULL)), NULL);
+  ValList* nested2 = createListNode(createVal(ValueType_LIST, (intptr_t) createListNode(createVal(ValueType_INT, 1), NULL)), NULL);
+  CU_ASSERT(nested1 != nested2);
+  CU_ASSERT(getListsEqual(createVal(ValueType_LIST, (intptr_t) nested1), createVal(ValueType_LIST, (intptr_t) nested2)));
+}
+void testLIBRARY(void)
+{
+  Interpreter* first = interpreterNew();
+  Interpreter* second = interpreterNew();
+  Val result;
+  CU_ASSERT(interpreterDefine(first, "fun f(x) = x+1; val y = 2;") == InterpreterStatus_OK);
+  CU_ASSERT(interpreterDefine(second, "fun f(x) = x*10;") == InterpreterStatus_OK);
+  CU_ASSERT(interpreterEval(first, "f(y);", &result) == InterpreterStatus_OK);
+  CU_ASSERT(getIntVal(result) == 3);
+  CU_ASSERT(interpreterEval(second, "f(3);", &result) == InterpreterStatus_OK);
+  CU_ASSERT(getIntVal(result) == 30); // the instances do not share symbols
+  CU_ASSERT(interpreterDefine(first, "val w = f(10);") == InterpreterStatus_OK);
+  CU_ASSERT(interpreterEval(first, "w;", &result) == InterpreterStatus_OK);
+  CU_ASSERT(getIntVal(result) == 11);
+  CU_ASSERT(interpreterDefine(first, "fun f(x) = x*2;") == InterpreterStatus_OK);
+  CU_ASSERT(interpreterEval(first, "w;", &result) == InterpreterStatus_OK);
+  CU_ASSERT(getIntVal(result) == 20); // values using a redefined function are evaluated again
+  CU_ASSERT(interpreterDefine(first, "fun plus(x) = x;") == InterpreterStatus_REDEFINITION);
+  CU_ASSERT(interpreterDefine(first, "f(1);") == InterpreterStatus_NOT_DEFINITION);
+  CU_ASSERT(interpreterEval(first, "val z = 1;", &result) == InterpreterStatus_NOT_EXPRESSION);
+  CU_ASSERT(interpreterEval(first, "f(;", &result) == InterpreterStatus_SYNTAX_ERROR);
+  interpreterFree(first);
+  interpreterFree(second);
+}
+
 int main()
 {
    CU_pSuite pSuite = NULL;
@@ -49,7 +94,9 @@ int main()
 
    /* add the tests to the suite */
    /* NOTE - ORDER IS IMPORTANT - MUST TEST fread() AFTER fprintf() */
-   if ((NULL == CU_add_test(pSuite, "test of structures", testVAL)))
+   if ((NULL == CU_add_test(pSuite, "test of structures", testVAL)) ||
+       (NULL == CU_add_test(pSuite, "test of hash-consing", testHASHCONS)) ||
+       (NULL == CU_add_test(pSuite, "test of the library", testLIBRARY)))
      {
        CU_cleanup_registry();
        return CU_get_error();
@@ -0,0 +1,491 @@
+/**
+ * @brief: This is the file containing the result cache.
+ * A cache file is a header followed by records, each holding a key, the size and checksum of the value and the value itself in a form that does not depend on where it was in memory. Records are only ever appended, each with a single write while the file is locked, so several runs may share a cache and a run that stops while writing leaves at most one incomplete record at the end.
+ * The key of an expression is a hash of the expression followed by the definitions of the symbols it uses, in the order they are first used, so the same program gets the same keys in every run and a changed definition changes the key of everything that uses it
+ * @file: cache.c
+ * @date: 19/10 2026
+ */
+#include "cache.h"
+#include "speculate.h"
+#include "stats.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "ITPCACHE"
+#define CACHE_VERSION 1
+#define MAX_CACHED_NODES (1 << 16) /** The most list nodes and vector elements, counting nested ones, that a cached value may have */
+
+/**
+ * Defines the start of a cache file.
+ */
+typedef struct {
+  char magic[8]; /** Always CACHE_MAGIC */
+  uint32_t version; /** The CACHE_VERSION the cache was written with */
+  uint32_t intSize; /** The size of an int value, caches are only used by builds with the same */
+} CacheHeader;
+
+/**
+ * Defines the start of a record, the value follows padded to a multiple of eight bytes.
+ */
+typedef struct {
+  uint64_t key[2]; /** The hash of the expression and the definitions it uses */
+  uint64_t size; /** The size of the value in bytes */
+  uint64_t check; /** A hash of the key and the value, records that do not match it are incomplete */
+} CacheRecord;
+
+/**
+ * Defines a value or key that is being written, and for a key the symbols it uses.
+ */
+typedef struct CacheWriter {
+  char* data; /** The bytes written */
+  size_t size; /** The number of bytes used */
+  size_t capacity; /** The number of bytes there is room for */
+  int failed; /** Nonzero if what is written can not be cached */
+  size_t nodes; /** The number of list nodes written */
+  map_t visited; /** For a key, the symbols written by name */
+  int symbols; /** For a key, the number of symbols written */
+  struct Enclosing* enclosing; /** For a key, the values whose expressions are being written */
+} CacheWriter;
+
+/**
+ * Defines a value whose expression is being written, linked to the value whose expression uses it.
+ */
+typedef struct Enclosing {
+  SymbolIdent* symbol; /** The value */
+  struct Enclosing* outer; /** The value being written when it was reached, NULL if none */
+} Enclosing;
+
+/**
+ * Defines a slot of the index of the records.
+ */
+typedef struct {
+  uint64_t key[2]; /** The key of the record */
+  const char* value; /** The value of the record, NULL if the slot is empty */
+  uint64_t size; /** The size of the value */
+} CacheSlot;
+
+static int cacheFd = -1; /** The cache file, opened for appending, -1 if no cache is used */
+static CacheSlot* slots = NULL; /** The index of the records by key */
+static uint64_t slotNum = 0; /** The number of records in the index */
+static uint64_t slotCapacity = 0; /** The size of slots, always a power of two */
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER; /** Guards the index and the appending of records */
+
+/**
+ * Mixes the bits of a hash
+ */
+static uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  return h ^ h >> 33;
+}
+
+/**
+ * Computes a 128 bit hash of a sequence of bytes, as two independent 64 bit hashes
+ */
+static void hashBytes(const char* data, size_t size, uint64_t hash[2]) {
+  uint64_t h1 = 0xcbf29ce484222325ULL ^ size;
+  uint64_t h2 = 0x84222325cbf29ce4ULL + size;
+  for (size_t i = 0; i < size; i++) {
+    h1 = (h1 ^ (unsigned char) data[i]) * 0x100000001b3ULL;
+    h2 = (h2 ^ (unsigned char) data[i]) * 0x9e3779b97f4a7c15ULL;
+  }
+  hash[0] = mix(h1);
+  hash[1] = mix(h2 ^ h1 >> 32);
+}
+
+/**
+ * Computes the checksum of a record
+ */
+static uint64_t checksum(const uint64_t key[2], const char* value, uint64_t size) {
+  uint64_t hash[2];
+  hashBytes(value, size, hash);
+  return mix(hash[0] ^ key[0]) ^ hash[1] ^ key[1];
+}
+
+/**
+ * Obtains the slot of a key in the index
+ * @return: the slot of the key, or the empty slot where it belongs
+ */
+static CacheSlot* findSlot(const uint64_t key[2]) {
+  uint64_t index = key[0] & (slotCapacity - 1);
+  while (slots[index].value && (slots[index].key[0] != key[0] || slots[index].key[1] != key[1]))
+    index = (index + 1) & (slotCapacity - 1);
+  return &slots[index];
+}
+
+/**
+ * Adds a record to the index, unless its key is there already. Must be called with cacheLock held
+ */
+static void addSlot(const uint64_t key[2], const char* value, uint64_t size) {
+  if (2 * (slotNum + 1) > slotCapacity) {
+    CacheSlot* old = slots;
+    uint64_t oldCapacity = slotCapacity;
+    slotCapacity *= 2;
+    slots = calloc(slotCapacity, sizeof(CacheSlot));
+    for (uint64_t i = 0; i < oldCapacity; i++) {
+      if (old[i].value)
+	*findSlot(old[i].key) = old[i];
+    }
+    free(old);
+  }
+  CacheSlot* slot = findSlot(key);
+  if (slot->value)
+    return;
+  slot->key[0] = key[0];
+  slot->key[1] = key[1];
+  slot->value = value;
+  slot->size = size;
+  slotNum++;
+}
+
+/**
+ * Locks or unlocks the cache file against other runs
+ * @param: F_WRLCK to lock, F_UNLCK to unlock
+ */
+static void lockFile(int fd, short type) {
+  struct flock lock;
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  fcntl(fd, F_SETLKW, &lock);
+}
+
+/**
+ * Maps a cache file into memory and indexes its records
+ */
+int openCache(const char* path) {
+  int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    printf("Failed to open cache %s\n", path);
+    return MAP_MISSING;
+  }
+  lockFile(fd, F_WRLCK);
+  struct stat info;
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CACHE_MAGIC, 8);
+  header.version = CACHE_VERSION;
+  header.intSize = sizeof(intptr_t);
+  if (!fstat(fd, &info) && !info.st_size && write(fd, &header, sizeof(header)) == sizeof(header))
+    fstat(fd, &info);
+  char* base = info.st_size >= (off_t) sizeof(header) ? mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  if (base == MAP_FAILED || memcmp(base, &header, sizeof(header))) {
+    printf("%s is not a cache of this version of the interpreter\n", path);
+    if (base != MAP_FAILED)
+      munmap(base, info.st_size);
+    lockFile(fd, F_UNLCK);
+    close(fd);
+    return MAP_MISSING;
+  }
+  pthread_mutex_lock(&cacheLock);
+  if (!slotCapacity) {
+    slotCapacity = 1024;
+    slots = calloc(slotCapacity, sizeof(CacheSlot));
+  }
+  uint64_t offset = sizeof(header);
+  while (offset + sizeof(CacheRecord) <= (uint64_t) info.st_size) {
+    CacheRecord record;
+    memcpy(&record, base + offset, sizeof(record));
+    uint64_t padded = (record.size + 7) & ~(uint64_t) 7;
+    if (padded > info.st_size - offset - sizeof(record) ||
+	record.check != checksum(record.key, base + offset + sizeof(record), record.size))
+      break;
+    addSlot(record.key, base + offset + sizeof(record), record.size);
+    offset += sizeof(record) + padded;
+  }
+  pthread_mutex_unlock(&cacheLock);
+  //Anything after the last complete record was cut short, new records go where it started
+  if (offset < (uint64_t) info.st_size)
+    ftruncate(fd, offset);
+  lockFile(fd, F_UNLCK);
+  cacheFd = fd;
+  return MAP_OK;
+}
+
+/**
+ * Appends bytes to what is being written
+ */
+static void putBytes(CacheWriter* writer, const void* bytes, size_t size) {
+  if (writer->size + size > writer->capacity) {
+    writer->capacity = 2 * writer->capacity + size + 256;
+    writer->data = realloc(writer->data, writer->capacity);
+  }
+  memcpy(writer->data + writer->size, bytes, size);
+  writer->size += size;
+}
+
+/**
+ * Appends a tag byte to what is being written
+ */
+static void putTag(CacheWriter* writer, char tag) {
+  putBytes(writer, &tag, 1);
+}
+
+/**
+ * Appends a string with its terminating zero to what is being written
+ */
+static void putString(CacheWriter* writer, const char* str) {
+  putBytes(writer, str, strlen(str) + 1);
+}
+
+/**
+ * Appends a value, forcing lazy lists. Lists without a known end, and lists longer than MAX_CACHED_NODES, make the writer fail
+ */
+static void putVal(CacheWriter* writer, Val v) {
+  switch (getType(v)) {
+  case ValueType_INT: {
+    intptr_t value = getIntVal(v);
+    putTag(writer, 'i');
+    putBytes(writer, &value, sizeof(value));
+    break;
+  }
+  case ValueType_LIST:
+    putTag(writer, 'l');
+    for (ValList* list = getListVal(v); list && !writer->failed; list = getNextNode(list)) {
+      if (++writer->nodes > MAX_CACHED_NODES || (list->rest && list->rest->state != ThunkState_DONE &&
+	  (list->rest->length < 0 || writer->nodes + list->rest->length > MAX_CACHED_NODES))) {
+	writer->failed = 1;
+	return;
+      }
+      putVal(writer, list->value);
+    }
+    putTag(writer, '.');
+    break;
+  case ValueType_CONSTANT:
+  case ValueType_FUNCTION:
+    putTag(writer, getType(v) == ValueType_CONSTANT ? 'c' : 'f');
+    putString(writer, getCharVal(v));
+    break;
+  case ValueType_VECTOR: {
+    Vector* vector = getVectorVal(v);
+    writer->nodes += vector->length;
+    if (writer->nodes > MAX_CACHED_NODES) {
+      writer->failed = 1;
+      return;
+    }
+    putTag(writer, 'v');
+    putBytes(writer, &vector->length, sizeof(vector->length));
+    for (intptr_t i = 0; i < vector->length && !writer->failed; i++)
+      putVal(writer, vector->elements[i]);
+    break;
+  }
+  }
+}
+
+static void putTree(CacheWriter* writer, TreeNode* node, NameListNode* bound);
+
+/**
+ * Appends the definition of a symbol a tree uses, unless it has been written already. A name that is not defined, a builtin that does not always compute the same value, or a value that uses itself, makes the writer fail
+ * @param: The writer, the name, whether it is the name of a constant, and the arguments bound where it is used
+ */
+static void putSymbol(CacheWriter* writer, char* name, int constant, NameListNode* bound) {
+  NameListNode* argument = constant ? bound : NULL;
+  while (argument && strcmp(argument->name, name))
+    argument = argument->next;
+  if (argument || !strcmp(name, "ite"))
+    return;
+  if (!strcmp(name, "time") || !strcmp(name, "timing") || !strcmp(name, "stats")) {
+    writer->failed = 1;
+    return;
+  }
+  if (exists(name))
+    return;
+  SymbolIdent* symbol;
+  if (hashmap_get(writer->visited, name, (any_t*) &symbol) == MAP_OK) {
+    for (Enclosing* outer = writer->enclosing; outer; outer = outer->outer) {
+      if (outer->symbol == symbol)
+	writer->failed = 1;
+    }
+    return;
+  }
+  if (hashmap_get(context->symbols, name, (any_t*) &symbol) != MAP_OK) {
+    writer->failed = 1;
+    return;
+  }
+  hashmap_put(writer->visited, name, symbol);
+  writer->symbols++;
+  putTag(writer, 's');
+  putString(writer, name);
+  for (NameListNode* arg = symbol->argNames; arg; arg = arg->next)
+    putString(writer, arg->name);
+  putTag(writer, '.');
+  if (symbol->argNames)
+    putTree(writer, symbol->parseTree, symbol->argNames);
+  else {
+    Enclosing current = {symbol, writer->enclosing};
+    writer->enclosing = &current;
+    putTree(writer, symbol->expression ? symbol->expression : symbol->parseTree, NULL);
+    writer->enclosing = current.outer;
+  }
+}
+
+/**
+ * Appends a tree followed by the definitions of the symbols it uses that have not been written already
+ * @param: The writer, the tree, and the arguments bound in the tree
+ */
+static void putTree(CacheWriter* writer, TreeNode* node, NameListNode* bound) {
+  uint32_t children = 0;
+  for (PointerListNode* child = node->argList; child; child = child->next)
+    children++;
+  putTag(writer, 't');
+  putVal(writer, node->value);
+  putBytes(writer, &children, sizeof(children));
+  for (PointerListNode* child = node->argList; child && !writer->failed; child = child->next)
+    putTree(writer, child->target, bound);
+  ValueType type = getType(node->value);
+  if (!writer->failed && (type == ValueType_CONSTANT || type == ValueType_FUNCTION))
+    putSymbol(writer, getCharVal(node->value), type == ValueType_CONSTANT, bound);
+}
+
+/**
+ * Reads a value written by putVal
+ * @param: Where to read from, which is moved past the value, and the end of the record
+ * @return: 1 if a value was read, 0 if the record is malformed
+ */
+static int getVal(const char** at, const char* end, Val* v) {
+  if (*at >= end)
+    return 0;
+  char tag = *(*at)++;
+  switch (tag) {
+  case 'i': {
+    intptr_t value;
+    if (end - *at < (ptrdiff_t) sizeof(value))
+      return 0;
+    memcpy(&value, *at, sizeof(value));
+    *at += sizeof(value);
+    *v = createVal(ValueType_INT, value);
+    return 1;
+  }
+  case 'l': {
+    //The elements are read first, the list is built from the last one
+    Val* elements = NULL;
+    int num = 0;
+    int capacity = 0;
+    while (*at < end && **at != '.') {
+      if (num == capacity) {
+	capacity = 2 * capacity + 16;
+	elements = realloc(elements, sizeof(Val) * capacity);
+      }
+      if (!getVal(at, end, &elements[num++])) {
+	free(elements);
+	return 0;
+      }
+    }
+    if (*at >= end) {
+      free(elements);
+      return 0;
+    }
+    (*at)++;
+    ValList* list = NULL;
+    while (num)
+      list = createListNode(elements[--num], list);
+    free(elements);
+    *v = createVal(ValueType_LIST, (intptr_t) list);
+    return 1;
+  }
+  case 'v': {
+    intptr_t length;
+    if (end - *at < (ptrdiff_t) sizeof(length))
+      return 0;
+    memcpy(&length, *at, sizeof(length));
+    *at += sizeof(length);
+    if (length < 0 || length > end - *at)
+      return 0;
+    Vector* vector = createVector(length);
+    for (intptr_t i = 0; i < length; i++) {
+      if (!getVal(at, end, &vector->elements[i])) {
+	free(vector);
+	return 0;
+      }
+    }
+    *v = createVal(ValueType_VECTOR, (intptr_t) vector);
+    return 1;
+  }
+  case 'c':
+  case 'f': {
+    const char* terminator = memchr(*at, 0, end - *at);
+    if (!terminator)
+      return 0;
+    *v = createVal(tag == 'c' ? ValueType_CONSTANT : ValueType_FUNCTION, (intptr_t) strdup(*at));
+    *at = terminator + 1;
+    return 1;
+  }
+  default:
+    return 0;
+  }
+}
+
+/**
+ * Appends a value to the cache file and the index
+ */
+static void storeValue(const uint64_t key[2], Val value) {
+  CacheWriter writer;
+  memset(&writer, 0, sizeof(writer));
+  putBytes(&writer, &(CacheRecord) {{0}}, sizeof(CacheRecord));
+  putVal(&writer, value);
+  if (writer.failed) {
+    free(writer.data);
+    return;
+  }
+  uint64_t size = writer.size - sizeof(CacheRecord);
+  uint64_t padding = 0;
+  putBytes(&writer, &padding, ((size + 7) & ~(uint64_t) 7) - size);
+  CacheRecord* record = (CacheRecord*) writer.data;
+  record->key[0] = key[0];
+  record->key[1] = key[1];
+  record->size = size;
+  record->check = checksum(key, writer.data + sizeof(CacheRecord), size);
+  pthread_mutex_lock(&cacheLock);
+  lockFile(cacheFd, F_WRLCK);
+  if (write(cacheFd, writer.data, writer.size) != (ssize_t) writer.size)
+    printf("Failed to write to the cache\n");
+  lockFile(cacheFd, F_UNLCK);
+  //The index keeps the bytes written, they are never freed
+  addSlot(key, writer.data + sizeof(CacheRecord), size);
+  pthread_mutex_unlock(&cacheLock);
+}
+
+/**
+ * Evaluates an expression unless the cache has its value
+ */
+Val evalCached(TreeNode* tree) {
+  if (cacheFd < 0)
+    return eval(tree, NULL, 0);
+  CacheWriter key;
+  memset(&key, 0, sizeof(key));
+  key.visited = hashmap_new();
+  putTag(&key, CACHE_VERSION);
+  putTree(&key, tree, NULL);
+  hashmap_free(key.visited);
+  if (key.failed || !key.symbols) {
+    free(key.data);
+    return eval(tree, NULL, 0);
+  }
+  uint64_t hash[2];
+  hashBytes(key.data, key.size, hash);
+  free(key.data);
+  pthread_mutex_lock(&cacheLock);
+  CacheSlot* slot = findSlot(hash);
+  const char* at = slot->value;
+  const char* end = at + slot->size;
+  pthread_mutex_unlock(&cacheLock);
+  Val value;
+  if (at && getVal(&at, end, &value) && at == end) {
+    statsAdd(StatCounter_CACHE_HITS, 1);
+    return value;
+  }
+  value = eval(tree, NULL, 0);
+  if (!speculationCancelled())
+    storeValue(hash, value);
+  return value;
+}
@@ -0,0 +1,25 @@
+/**
+ * @brief: Header for the result cache, a file shared between runs that keeps the values of expressions keyed by the expression and every definition it uses
+ * @file: cache.h
+ * @date: 19/10 2026
+ */
+
+#ifndef CACHE_HEADER
+#define CACHE_HEADER
+#include "eval.h"
+
+/**
+ * Maps a cache file into memory, creating it if it does not exist, and uses it for the rest of the run.
+ * A record left incomplete by a run that stopped while writing it is cut off
+ * @return: MAP_OK if the cache is used, MAP_MISSING if the file could not be opened or is not a cache of this version of the interpreter
+ */
+int openCache(const char* path);
+/**
+ * Evaluates a top-level expression, or the expression of a value, unless the cache has its value.
+ * The key is a hash of the expression and of the definitions of the functions and values it uses, directly or through each other, so a result is never used once any of them changes. Expressions that use no user-defined symbols, use time, timing or stats, use a name that is not defined, or evaluate to an unbounded list or a very long list or vector are evaluated as usual and not cached, and neither are values computed for a cancelled speculation
+ * @param: The expression, which may only use top-level symbols
+ * @return: the value of the expression
+ */
+Val evalCached(TreeNode* tree);
+
+#endif
@@ -0,0 +1,641 @@
+/**
+ * @brief: This is the file containing the compiler, which translates declarations to a standalone C program.
+ * Every user-defined function becomes a C function of the same arguments over a tagged value V. List nodes know the length of the list they start, so length takes constant time. Expressions become C expressions, except where two or more arguments of a call call functions: such a call becomes a helper function that evaluates those arguments on threads of their own, as the evaluator does. List and vector constants are built once when the program starts
+ * @file: compiler.c
+ * @date: 19/10 2026
+ */
+#undef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700 //for open_memstream
+#include "compiler.h"
+#include "eval.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The runtime every program starts with
+ */
+static const char* runtime =
+  "#include <pthread.h>\n"
+  "#include <stdint.h>\n"
+  "#include <stdio.h>\n"
+  "#include <stdlib.h>\n"
+  "#include <time.h>\n"
+  "\n"
+  "typedef struct L L;\n"
+  "typedef struct { intptr_t v; int list; } V;\n"
+  "struct L { V head; L* next; V (*step)(V); intptr_t length; };\n"
+  "typedef struct { V* e; intptr_t n; } W;\n"
+  "typedef struct { V (*task)(V*); V* env; V* out; pthread_t id; int forked; } RtFork;\n"
+  "\n"
+  "static volatile int rtThreads = 0;\n"
+  "static volatile long rtForks = 0;\n"
+  "static volatile intptr_t rtSink;\n"
+  "static V rt_int(intptr_t v) { V r = {v, 0}; return r; }\n"
+  "static V rt_list(L* l) { V r = {(intptr_t) l, 1}; return r; }\n"
+  "static L* rt_nodes(V v) { return (L*) v.v; }\n"
+  "static V rt_vector(V* e, intptr_t n) { W* w = malloc(sizeof(W)); w->e = e; w->n = n; V r = {(intptr_t) w, 2}; return r; }\n"
+  "static W* rt_elements(V v) { return (W*) v.v; }\n"
+  "static L* rt_node(V head, L* next) { L* n = malloc(sizeof(L)); n->head = head; n->next = next; n->step = NULL; n->length = next ? (next->length < 0 ? -1 : next->length + 1) : 1; return n; }\n"
+  "static L* rt_next(L* l) {\n"
+  "  if (l->step && !l->next) {\n"
+  "    L* n = rt_node(l->step(l->head), NULL);\n"
+  "    n->step = l->step;\n"
+  "    n->length = -1;\n"
+  "    __sync_bool_compare_and_swap(&l->next, NULL, n);\n"
+  "  }\n"
+  "  return l->next;\n"
+  "}\n"
+  "static V rt_iterate(V (*step)(V), V start) { L* l = rt_node(start, NULL); l->step = step; l->length = -1; return rt_list(l); }\n"
+  "static V rt_array(const intptr_t* data, long num) { L* l = NULL; while (num--) l = rt_node(rt_int(data[num]), l); return rt_list(l); }\n"
+  "static V rt_plus(V a, V b) { return rt_int(a.v + b.v); }\n"
+  "static V rt_minus(V a, V b) { return rt_int(a.v - b.v); }\n"
+  "static V rt_mult(V a, V b) { return rt_int(a.v * b.v); }\n"
+  "static V rt_divide(V a, V b) { return rt_int(a.v / b.v); }\n"
+  "static V rt_hd(V a) { return rt_nodes(a)->head; }\n"
+  "static V rt_tl(V a) { return rt_list(rt_next(rt_nodes(a))); }\n"
+  "static V rt_cons(V a, V b) { return rt_list(rt_node(a, rt_nodes(b))); }\n"
+  "static intptr_t rt_count(V a) { if (a.list == 2) return rt_elements(a)->n; intptr_t n = 0; L* l = rt_nodes(a); for (; l && l->length < 0; l = rt_next(l)) n++; return n + (l ? l->length : 0); }\n"
+  "static V rt_length(V a) { return rt_int(rt_count(a)); }\n"
+  "static V rt_tovector(V a) {\n"
+  "  if (a.list != 1) return a;\n"
+  "  intptr_t n = rt_count(a); V* e = malloc(sizeof(V) * (n ? n : 1)); L* l = rt_nodes(a);\n"
+  "  for (intptr_t i = 0; i < n; i++, l = rt_next(l)) e[i] = l->head;\n"
+  "  return rt_vector(e, n);\n"
+  "}\n"
+  "static V rt_tolist(V a) { if (a.list != 2) return a; W* w = rt_elements(a); L* l = NULL; for (intptr_t i = w->n; i--;) l = rt_node(w->e[i], l); return rt_list(l); }\n"
+  "static V rt_nth(V a, V i) { return rt_elements(rt_tovector(a))->e[i.v]; }\n"
+  "static V rt_slice(V a, V f, V t) {\n"
+  "  W* w = rt_elements(rt_tovector(a)); intptr_t from = f.v < 0 ? 0 : f.v; intptr_t to = t.v > w->n ? w->n : t.v;\n"
+  "  return rt_vector(w->e + from, to < from ? 0 : to - from);\n"
+  "}\n"
+  "static V rt_concat(V a, V b) {\n"
+  "  W* x = rt_elements(rt_tovector(a)); W* y = rt_elements(rt_tovector(b)); V* e = malloc(sizeof(V) * (x->n + y->n + 1));\n"
+  "  for (intptr_t i = 0; i < x->n; i++) e[i] = x->e[i];\n"
+  "  for (intptr_t i = 0; i < y->n; i++) e[x->n + i] = y->e[i];\n"
+  "  return rt_vector(e, x->n + y->n);\n"
+  "}\n"
+  "static V rt_len(V a) { return a.list == 2 ? rt_int(rt_elements(a)->n) : rt_length(a); }\n"
+  "static int rt_same(V a, V b) {\n"
+  "  if (a.list != b.list) return 0;\n"
+  "  if (!a.list) return a.v == b.v;\n"
+  "  if (a.list == 2) {\n"
+  "    W* x = rt_elements(a); W* y = rt_elements(b);\n"
+  "    if (x->n != y->n) return 0;\n"
+  "    for (intptr_t i = 0; i < x->n; i++)\n"
+  "      if (!rt_same(x->e[i], y->e[i])) return 0;\n"
+  "    return 1;\n"
+  "  }\n"
+  "  L* x = rt_nodes(a); L* y = rt_nodes(b);\n"
+  "  for (; x && y && x != y; x = rt_next(x), y = rt_next(y))\n"
+  "    if (!rt_same(x->head, y->head)) return 0;\n"
+  "  return x == y;\n"
+  "}\n"
+  "static V rt_equals(V a, V b) { return rt_int(rt_same(a, b)); }\n"
+  "static V rt_lesser(V a, V b) { if (a.list != b.list) return rt_int(0); return rt_int(a.list == 2 ? rt_elements(a)->n < rt_elements(b)->n : a.list ? rt_count(a) < rt_count(b) : a.v < b.v); }\n"
+  "static V rt_greater(V a, V b) { return rt_lesser(b, a); }\n"
+  "static V rt_sort(V a, V (*before)(V, V)) {\n"
+  "  W* w = rt_elements(rt_tovector(a)); intptr_t n = w->n;\n"
+  "  V* e = malloc(sizeof(V) * (n ? n : 1)); V* s = malloc(sizeof(V) * (n ? n : 1));\n"
+  "  for (intptr_t i = 0; i < n; i++) e[i] = w->e[i];\n"
+  "  for (intptr_t width = 1; width < n; width *= 2)\n"
+  "    for (intptr_t lo = 0; lo + width < n; lo += 2 * width) {\n"
+  "      intptr_t mid = lo + width; intptr_t hi = mid + width < n ? mid + width : n; intptr_t i = lo; intptr_t j = mid; intptr_t k = lo;\n"
+  "      while (i < mid && j < hi) s[k++] = (before ? before(e[j], e[i]) : rt_lesser(e[j], e[i])).v ? e[j++] : e[i++];\n"
+  "      while (i < mid) s[k++] = e[i++];\n"
+  "      while (j < hi) s[k++] = e[j++];\n"
+  "      for (k = lo; k < hi; k++) e[k] = s[k];\n"
+  "    }\n"
+  "  free(s);\n"
+  "  if (a.list == 2) return rt_vector(e, n);\n"
+  "  L* l = NULL; for (intptr_t i = n; i--;) l = rt_node(e[i], l);\n"
+  "  free(e);\n"
+  "  return rt_list(l);\n"
+  "}\n"
+  "static V rt_range(V a, V b) { L* l = NULL; for (intptr_t i = b.v - 1; i >= a.v; i--) l = rt_node(rt_int(i), l); return rt_list(l); }\n"
+  "static intptr_t rt_clock(clockid_t clock) { struct timespec t; clock_gettime(clock, &t); return (intptr_t) t.tv_sec * 1000000000 + t.tv_nsec; }\n"
+  "static void* rt_run(void* arguments) { RtFork* f = arguments; *f->out = f->task(f->env); __sync_fetch_and_sub(&rtThreads, 1); return 0; }\n"
+  "static void rt_spawn(RtFork* f, V (*task)(V*), V* env, V* out) {\n"
+  "  f->task = task; f->env = env; f->out = out; f->forked = 0;\n"
+  "  if (rtThreads < MAX_THREADS) {\n"
+  "    __sync_fetch_and_add(&rtThreads, 1);\n"
+  "    __sync_fetch_and_add(&rtForks, 1);\n"
+  "    f->forked = !pthread_create(&f->id, NULL, rt_run, f);\n"
+  "    if (!f->forked) __sync_fetch_and_sub(&rtThreads, 1);\n"
+  "  }\n"
+  "}\n"
+  "static void rt_join(RtFork* f) { if (f->forked) pthread_join(f->id, NULL); else *f->out = f->task(f->env); }\n"
+  "static void rt_write(V v) {\n"
+  "  if (!v.list) { printf(\"%ld\", (long) v.v); return; }\n"
+  "  if (v.list == 2) {\n"
+  "    putchar('{');\n"
+  "    for (intptr_t i = 0; i < rt_elements(v)->n; i++) { if (i) putchar(','); rt_write(rt_elements(v)->e[i]); }\n"
+  "    putchar('}');\n"
+  "    return;\n"
+  "  }\n"
+  "  putchar('[');\n"
+  "  for (L* l = rt_nodes(v); l; l = rt_next(l)) { rt_write(l->head); if (rt_next(l)) putchar(','); }\n"
+  "  putchar(']');\n"
+  "}\n"
+  "\n";
+
+/**
+ * Defines the state of one compilation.
+ */
+typedef struct {
+  map_t declared; /** The functions and values declared so far by name */
+  map_t emitted; /** The functions and values of the interpreter that are emitted, by name */
+  SymbolIdent** pending; /** The functions of the interpreter that are used but not emitted yet */
+  int pendingNum; /** The number of pending functions */
+  int pendingCapacity; /** The size of pending */
+  FILE* prototypes; /** The declarations of every C function */
+  FILE* definitions; /** The definitions of every C function */
+  FILE* constants; /** The code building the list constants, run first by main */
+  int helpers; /** The number of helper functions and constants made so far */
+  int failed; /** Nonzero once something could not be compiled */
+} Compiler;
+
+/**
+ * Finds a function or value by name, first among the declarations, then in the interpreter
+ * @return: the symbol, or NULL if it is not defined
+ */
+static SymbolIdent* lookup(Compiler* compiler, const char* name) {
+  SymbolIdent* symbol;
+  if (hashmap_get(compiler->declared, (char*) name, (any_t*) &symbol) == MAP_OK)
+    return symbol;
+  if (hashmap_get(context->symbols, (char*) name, (any_t*) &symbol) == MAP_OK)
+    return symbol;
+  return NULL;
+}
+
+/**
+ * Counts the names in a list of argument names
+ */
+static int countNames(NameListNode* names) {
+  int num = 0;
+  for (; names; names = names->next)
+    num++;
+  return num;
+}
+
+/**
+ * Writes the parameter list of a function with arguments a0, a1...
+ */
+static void writeParameters(FILE* out, int num) {
+  fprintf(out, "(");
+  for (int i = 0; i < num; i++)
+    fprintf(out, "%sV a%d", i ? ", " : "", i);
+  fprintf(out, num ? ")" : "void)");
+}
+
+/**
+ * Writes the arguments a0, a1... of a call of a function with the same parameters
+ */
+static void writeArguments(FILE* out, int num) {
+  fprintf(out, "(");
+  for (int i = 0; i < num; i++)
+    fprintf(out, "%sa%d", i ? ", " : "", i);
+  fprintf(out, ")");
+}
+
+/**
+ * Examines whether the evaluator would fork a thread for an argument
+ */
+static int forkable(TreeNode* node) {
+  return getType(node->value) == ValueType_FUNCTION && !exists(getCharVal(node->value));
+}
+
+static int compileList(Compiler* compiler, ValList* list);
+static int compileVector(Compiler* compiler, Vector* vector);
+
+/**
+ * Builds the list or vector constant an element of a constant holds
+ * @return: the number of the constant, or -1 if the element is an int
+ */
+static int compileElement(Compiler* compiler, Val element) {
+  if (getType(element) == ValueType_LIST)
+    return compileList(compiler, getListVal(element));
+  if (getType(element) == ValueType_VECTOR)
+    return compileVector(compiler, getVectorVal(element));
+  return -1;
+}
+
+/**
+ * Builds a list constant once, when the program starts
+ * @return: the number of the constant, c followed by the number is its name in the program
+ */
+static int compileList(Compiler* compiler, ValList* list) {
+  int flat = 1;
+  long num = 0;
+  for (ValList* node = list; node; node = getNextNode(node), num++) {
+    if (node->rest && node->rest->state != ThunkState_DONE && node->rest->length < 0) {
+      printf("Can not compile an unbounded list\n");
+      compiler->failed = 1;
+      return 0;
+    }
+    if (getType(node->value) != ValueType_INT)
+      flat = 0;
+  }
+  int number = compiler->helpers++;
+  fprintf(compiler->prototypes, "static V c%d;\n", number);
+  if (flat) {
+    fprintf(compiler->prototypes, "static const intptr_t c%dData[] = {", number);
+    for (ValList* node = list; node; node = getNextNode(node))
+      fprintf(compiler->prototypes, "%ldLL,", (long) getIntVal(node->value));
+    fprintf(compiler->prototypes, "0};\n");
+    fprintf(compiler->constants, "  c%d = rt_array(c%dData, %ld);\n", number, number, num);
+    return number;
+  }
+  //Nested lists are built from the last node, after the lists they contain
+  int* items = malloc(sizeof(int) * num);
+  long i = 0;
+  for (ValList* node = list; node; node = getNextNode(node), i++)
+    items[i] = compileElement(compiler, node->value);
+  fprintf(compiler->constants, "  {\n    L* l = NULL;\n");
+  i = 0;
+  ValList** nodes = malloc(sizeof(ValList*) * num);
+  for (ValList* node = list; node; node = getNextNode(node))
+    nodes[i++] = node;
+  while (i--) {
+    if (items[i] >= 0)
+      fprintf(compiler->constants, "    l = rt_node(c%d, l);\n", items[i]);
+    else
+      fprintf(compiler->constants, "    l = rt_node(rt_int(%ldLL), l);\n", (long) getIntVal(nodes[i]->value));
+  }
+  fprintf(compiler->constants, "    c%d = rt_list(l);\n  }\n", number);
+  free(items);
+  free(nodes);
+  return number;
+}
+
+/**
+ * Builds a vector constant once, when the program starts, after the constants it holds
+ * @return: the number of the constant, c followed by the number is its name in the program
+ */
+static int compileVector(Compiler* compiler, Vector* vector) {
+  long num = vector->length;
+  int* items = malloc(sizeof(int) * (num ? num : 1));
+  for (long i = 0; i < num; i++)
+    items[i] = compileElement(compiler, vector->elements[i]);
+  int number = compiler->helpers++;
+  fprintf(compiler->prototypes, "static V c%d;\n", number);
+  fprintf(compiler->constants, "  {\n    V* e = malloc(sizeof(V) * %ld);\n", num ? num : 1);
+  for (long i = 0; i < num; i++) {
+    if (items[i] >= 0)
+      fprintf(compiler->constants, "    e[%ld] = c%d;\n", i, items[i]);
+    else
+      fprintf(compiler->constants, "    e[%ld] = rt_int(%ldLL);\n", i, (long) getIntVal(vector->elements[i]));
+  }
+  fprintf(compiler->constants, "    c%d = rt_vector(e, %ld);\n  }\n", number, num);
+  free(items);
+  return number;
+}
+
+static void compileTree(Compiler* compiler, FILE* out, TreeNode* node, NameListNode* names);
+
+/**
+ * Writes a value known when compiling as an expression
+ */
+static void compileValue(Compiler* compiler, FILE* out, Val value) {
+  if (getType(value) == ValueType_VECTOR)
+    fprintf(out, "c%d", compileVector(compiler, getVectorVal(value)));
+  else if (getType(value) == ValueType_LIST && getListVal(value))
+    fprintf(out, "c%d", compileList(compiler, getListVal(value)));
+  else if (getType(value) == ValueType_LIST)
+    fprintf(out, "rt_list(NULL)");
+  else
+    fprintf(out, "rt_int(%ldLL)", (long) getIntVal(value));
+}
+
+/**
+ * Finds a user-defined function or value that a program uses. Those the interpreter already had are added to the program: values are set before anything is evaluated, and functions are emitted once the declarations are done
+ * @return: the symbol, or NULL if it is not defined, in which case the compilation has failed
+ */
+static SymbolIdent* useSymbol(Compiler* compiler, char* name) {
+  SymbolIdent* symbol = lookup(compiler, name);
+  if (!symbol) {
+    printf("Can not compile %s, it is not defined\n", name);
+    compiler->failed = 1;
+    return NULL;
+  }
+  void* found;
+  if (hashmap_get(compiler->declared, name, &found) == MAP_OK || hashmap_get(compiler->emitted, name, &found) == MAP_OK)
+    return symbol;
+  hashmap_put(compiler->emitted, name, symbol);
+  if (!symbol->argNames) {
+    char* value = NULL;
+    size_t length;
+    FILE* valueOut = open_memstream(&value, &length);
+    compileValue(compiler, valueOut, evalValue(symbol));
+    fclose(valueOut);
+    fprintf(compiler->prototypes, "static V v%s;\n", name);
+    fprintf(compiler->constants, "  v%s = %s;\n", name, value);
+    free(value);
+    return symbol;
+  }
+  if (compiler->pendingNum == compiler->pendingCapacity) {
+    compiler->pendingCapacity = 2 * compiler->pendingCapacity + 8;
+    compiler->pending = realloc(compiler->pending, sizeof(SymbolIdent*) * compiler->pendingCapacity);
+  }
+  compiler->pending[compiler->pendingNum++] = symbol;
+  return symbol;
+}
+
+/**
+ * Writes the call of a built-in or user-defined function with its arguments already written
+ * @param: The compiler, the stream, the name of the function, and the expressions of the arguments
+ */
+static void compileCall(Compiler* compiler, FILE* out, char* name, char* arguments[], int num) {
+  if (exists(name))
+    fprintf(out, "rt_%s(", name);
+  else {
+    SymbolIdent* symbol = useSymbol(compiler, name);
+    if (!symbol)
+      return;
+    if (!symbol->argNames) {
+      fprintf(out, "v%s", name);
+      return;
+    }
+    if (countNames(symbol->argNames) != num) {
+      printf("Can not compile the call of %s, it takes %d arguments\n", name, countNames(symbol->argNames));
+      compiler->failed = 1;
+      return;
+    }
+    fprintf(out, "f%s(", name);
+  }
+  for (int i = 0; i < num; i++)
+    fprintf(out, "%s%s", i ? ", " : "", arguments[i]);
+  fprintf(out, ")");
+}
+
+/**
+ * Writes a helper function that evaluates a tree, with the same parameters as the function the tree belongs to
+ * @return: the number of the helper, which is called h followed by the number
+ */
+static int compileHelper(Compiler* compiler, const char* body, int parameters) {
+  int number = compiler->helpers++;
+  fprintf(compiler->prototypes, "static V h%d", number);
+  writeParameters(compiler->prototypes, parameters);
+  fprintf(compiler->prototypes, ";\n");
+  fprintf(compiler->definitions, "static V h%d", number);
+  writeParameters(compiler->definitions, parameters);
+  fprintf(compiler->definitions, " {\n%s}\n\n", body);
+  return number;
+}
+
+/**
+ * Writes the expression of a tree
+ * @param: The compiler, the stream, the tree, and the names of the arguments of the function the tree belongs to
+ */
+static void compileTree(Compiler* compiler, FILE* out, TreeNode* node, NameListNode* names) {
+  char* name = getCharVal(node->value);
+  int parameters = countNames(names);
+  switch (getType(node->value)) {
+  case ValueType_INT:
+  case ValueType_LIST:
+  case ValueType_VECTOR:
+    compileValue(compiler, out, node->value);
+    return;
+  case ValueType_CONSTANT:
+    for (int i = 0; names; names = names->next, i++) {
+      if (!strcmp(names->name, name)) {
+	fprintf(out, "a%d", i);
+	return;
+      }
+    }
+  case ValueType_FUNCTION:
+    break;
+  }
+  char* text = NULL;
+  size_t length;
+  FILE* body;
+  if (!strcmp(name, "ite")) {
+    fprintf(out, "(");
+    compileTree(compiler, out, getArgNode(node, 0), names);
+    fprintf(out, ".v ? ");
+    compileTree(compiler, out, getArgNode(node, 1), names);
+    fprintf(out, " : ");
+    compileTree(compiler, out, getArgNode(node, 2), names);
+    fprintf(out, ")");
+    return;
+  }
+  if (!strcmp(name, "time") || !strcmp(name, "timing")) {
+    body = open_memstream(&text, &length);
+    fprintf(body, "  long forks = rtForks;\n  intptr_t cpu = rt_clock(CLOCK_PROCESS_CPUTIME_ID);\n  intptr_t wall = rt_clock(CLOCK_MONOTONIC);\n  rtSink = ");
+    compileTree(compiler, body, getArgNode(node, 0), names);
+    fprintf(body, ".v;\n  wall = rt_clock(CLOCK_MONOTONIC) - wall;\n  cpu = rt_clock(CLOCK_PROCESS_CPUTIME_ID) - cpu;\n");
+    if (!strcmp(name, "time"))
+      fprintf(body, "  return rt_int(wall);\n");
+    else
+      fprintf(body, "  return rt_list(rt_node(rt_int(wall), rt_node(rt_int(cpu), rt_node(rt_int(rtForks - forks), NULL))));\n");
+    fclose(body);
+    fprintf(out, "h%d", compileHelper(compiler, text, parameters));
+    writeArguments(out, parameters);
+    free(text);
+    return;
+  }
+  if (!strcmp(name, "iterate")) {
+    if (!namesFunction(node, 2, 0)) {
+      printf("Can not compile iterate, it needs the name of a function and a start value\n");
+      compiler->failed = 1;
+      return;
+    }
+    SymbolIdent* symbol = useSymbol(compiler, getCharVal(getArgNode(node, 0)->value));
+    if (symbol && countNames(symbol->argNames) != 1) {
+      printf("Can not compile iterate, it needs a function of one argument\n");
+      compiler->failed = 1;
+    }
+    if (!symbol || compiler->failed)
+      return;
+    fprintf(out, "rt_iterate(f%s, ", symbol->name);
+    compileTree(compiler, out, getArgNode(node, 1), names);
+    fprintf(out, ")");
+    return;
+  }
+  if (!strcmp(name, "sort")) {
+    if (!namesFunction(node, 1, -1) && !namesFunction(node, 2, 1)) {
+      printf("Can not compile sort, it needs a list and the name of a function\n");
+      compiler->failed = 1;
+      return;
+    }
+    SymbolIdent* symbol = NULL;
+    if (node->argList->next) {
+      symbol = useSymbol(compiler, getCharVal(getArgNode(node, 1)->value));
+      if (symbol && countNames(symbol->argNames) != 2) {
+	printf("Can not compile sort, it needs a function of two arguments\n");
+	compiler->failed = 1;
+      }
+      if (!symbol || compiler->failed)
+	return;
+    }
+    fprintf(out, "rt_sort(");
+    compileTree(compiler, out, getArgNode(node, 0), names);
+    fprintf(out, ", %s%s)", symbol ? "f" : "NULL", symbol ? symbol->name : "");
+    return;
+  }
+  if (!strcmp(name, "stats")) {
+    printf("Can not compile stats\n");
+    compiler->failed = 1;
+    return;
+  }
+  int num = 0;
+  int forks = 0;
+  for (PointerListNode* child = node->argList; child; child = child->next, num++)
+    forks += forkable(child->target);
+  char* arguments[num ? num : 1];
+  size_t lengths[num ? num : 1];
+  PointerListNode* child = node->argList;
+  if (forks < 2) {
+    for (int i = 0; i < num; i++, child = child->next) {
+      FILE* argument = open_memstream(&arguments[i], &lengths[i]);
+      compileTree(compiler, argument, child->target, names);
+      fclose(argument);
+    }
+    compileCall(compiler, out, name, arguments, num);
+  }
+  else {
+    //Every argument that calls a function but the first is handed to a thread, which evaluates it with a copy of the arguments of the caller
+    body = open_memstream(&text, &length);
+    fprintf(body, "  V results[%d];\n  RtFork forks[%d];\n  V env[%d] = {", num, num, parameters ? parameters : 1);
+    for (int i = 0; i < parameters; i++)
+      fprintf(body, "%sa%d", i ? ", " : "", i);
+    fprintf(body, "%s};\n", parameters ? "" : "{0, 0}");
+    int forked[num];
+    int first = 1;
+    for (int i = 0; i < num; i++, child = child->next) {
+      arguments[i] = malloc(32);
+      sprintf(arguments[i], "results[%d]", i);
+      forked[i] = forkable(child->target) && !first;
+      if (forkable(child->target))
+	first = 0;
+      if (forked[i]) {
+	char* task = NULL;
+	size_t taskLength;
+	FILE* taskBody = open_memstream(&task, &taskLength);
+	for (int j = 0; j < parameters; j++)
+	  fprintf(taskBody, "  V a%d = env[%d];\n", j, j);
+	fprintf(taskBody, "  return ");
+	compileTree(compiler, taskBody, child->target, names);
+	fprintf(taskBody, ";\n");
+	fclose(taskBody);
+	int number = compiler->helpers++;
+	fprintf(compiler->prototypes, "static V t%d(V* env);\n", number);
+	fprintf(compiler->definitions, "static V t%d(V* env) {\n%s}\n\n", number, task);
+	free(task);
+	fprintf(body, "  rt_spawn(&forks[%d], t%d, env, &results[%d]);\n", i, number, i);
+      }
+    }
+    child = node->argList;
+    for (int i = 0; i < num; i++, child = child->next) {
+      if (!forked[i]) {
+	fprintf(body, "  results[%d] = ", i);
+	compileTree(compiler, body, child->target, names);
+	fprintf(body, ";\n");
+      }
+    }
+    for (int i = 0; i < num; i++) {
+      if (forked[i])
+	fprintf(body, "  rt_join(&forks[%d]);\n", i);
+    }
+    fprintf(body, "  return ");
+    compileCall(compiler, body, name, arguments, num);
+    fprintf(body, ";\n");
+    fclose(body);
+    fprintf(out, "h%d", compileHelper(compiler, text, parameters));
+    writeArguments(out, parameters);
+    free(text);
+  }
+  for (int i = 0; i < num; i++)
+    free(arguments[i]);
+}
+
+/**
+ * Writes the C function of a user-defined function
+ */
+static void compileFunction(Compiler* compiler, SymbolIdent* symbol) {
+  int parameters = countNames(symbol->argNames);
+  fprintf(compiler->prototypes, "static V f%s", symbol->name);
+  writeParameters(compiler->prototypes, parameters);
+  fprintf(compiler->prototypes, ";\n");
+  //The helpers of the body are written to the definitions while it is compiled, so the body is written after them
+  char* body = NULL;
+  size_t length;
+  FILE* bodyOut = open_memstream(&body, &length);
+  compileTree(compiler, bodyOut, symbol->parseTree, symbol->argNames);
+  fclose(bodyOut);
+  fprintf(compiler->definitions, "static V f%s", symbol->name);
+  writeParameters(compiler->definitions, parameters);
+  fprintf(compiler->definitions, " {\n  return %s;\n}\n\n", body);
+  free(body);
+}
+
+/**
+ * Writes a C program for a list of declarations
+ */
+int compileProgram(SymbolIdent* declarations[], int num, FILE* out) {
+  Compiler compiler;
+  memset(&compiler, 0, sizeof(Compiler));
+  compiler.declared = hashmap_new();
+  compiler.emitted = hashmap_new();
+  char* prototypes = NULL;
+  char* definitions = NULL;
+  char* constants = NULL;
+  char* steps = NULL;
+  size_t length;
+  compiler.prototypes = open_memstream(&prototypes, &length);
+  compiler.definitions = open_memstream(&definitions, &length);
+  compiler.constants = open_memstream(&constants, &length);
+  FILE* program = open_memstream(&steps, &length);
+  void* found;
+  //Every name is declared first, so that bodies may use functions and values declared after them, as they may when interpreted
+  for (int i = 0; i < num && !compiler.failed; i++) {
+    char* name = declarations[i]->name;
+    if (!name || exists(name))
+      continue;
+    if (hashmap_get(compiler.declared, name, &found) == MAP_OK || hashmap_get(context->symbols, name, &found) == MAP_OK) {
+      printf("Can not compile the redefinition of %s\n", name);
+      compiler.failed = 1;
+    }
+    else
+      hashmap_put(compiler.declared, name, declarations[i]);
+  }
+  for (int i = 0; i < num && !compiler.failed; i++) {
+    SymbolIdent* declaration = declarations[i];
+    char* name = declaration->name;
+    if (name && exists(name))
+      fprintf(program, "  printf(\"redefinition is not allowed\\n\");\n");
+    else if (name && declaration->argNames) {
+      compileFunction(&compiler, declaration);
+      fprintf(program, "  printf(\"Defined function %s\\n\");\n", name);
+    }
+    else {
+      fprintf(program, "  {\n    V value = ");
+      compileTree(&compiler, program, declaration->parseTree, NULL);
+      fprintf(program, ";\n");
+      if (name) {
+	fprintf(compiler.prototypes, "static V v%s;\n", name);
+	fprintf(program, "    v%s = value;\n    printf(\"Defined %s\\n\");\n  }\n", name, name);
+      }
+      else
+	fprintf(program, "    rt_write(value);\n    putchar('\\n');\n  }\n");
+    }
+  }
+  //Functions and values the interpreter had before, and the functions they call
+  for (int i = 0; i < compiler.pendingNum && !compiler.failed; i++)
+    compileFunction(&compiler, compiler.pending[i]);
+  hashmap_free(compiler.declared);
+  hashmap_free(compiler.emitted);
+  fclose(program);
+  fclose(compiler.prototypes);
+  fclose(compiler.definitions);
+  fclose(compiler.constants);
+  if (!compiler.failed) {
+    fprintf(out, "#define MAX_THREADS %d\n%s%s\n%s", context->maxThreads, runtime, prototypes, definitions);
+    fprintf(out, "int main() {\n%s%s  return 0;\n}\n", constants, steps);
+  }
+  free(prototypes);
+  free(definitions);
+  free(constants);
+  free(steps);
+  free(compiler.pending);
+  return !compiler.failed;
+}
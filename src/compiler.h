@@ -0,0 +1,20 @@
+/**
+ * @brief: Header for the compiler, which translates a program to a standalone C program
+ * @file: compiler.h
+ * @date: 19/10 2026
+ */
+
+#ifndef COMPILER_HEADER
+#define COMPILER_HEADER
+#include "structures.h"
+#include <stdio.h>
+
+/**
+ * Writes a C program that prints what the interpreter loop would print for a list of declarations, in text mode.
+ * Every function becomes a C function over a tagged value, and arguments that call functions are evaluated on threads of their own while there are threads left, as the evaluator does. Functions and values the interpreter of the current thread already has may be used, but not defined again, and values are evaluated where they are defined. Only the output is written, the interpreter is not changed
+ * @param: The declarations in order, their number, and the stream to write the program to
+ * @return: 1 if the program was written, 0 if a declaration can not be compiled, in which case the reason has been printed
+ */
+int compileProgram(SymbolIdent* declarations[], int num, FILE* out);
+
+#endif
@@ -0,0 +1,948 @@
+/**
+ * @brief: This is the file containing the evaluator, the built-in functions and the creation of the threads that evaluate arguments in parallel
+ * @file: eval.c
+ * @author: Jonatan Waern, Daniel Engh, Adam Olevall, Mikael Holmberg
+ * @date: 27/6 2013
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "eval.h"
+#include "cache.h"
+#include "hashcons.h"
+#include "jit.h"
+#include "lazy.h"
+#include "output.h"
+#include "peephole.h"
+#include "profile.h"
+#include "sort.h"
+#include "speculate.h"
+#include "stats.h"
+#include "trace.h"
+#include "types.h"
+#include <time.h>
+
+char* DEF_FUN[] = {"plus","minus","mult", "divide", "equals", "greater", "lesser", "hd", "tl", "cons", "length", "time", "timing", "range", "iterate", "stats", "nth", "slice", "concat", "len", "tovector", "tolist", "sort"}; /** These are the names of all the built-in functions, the array is used to make sure no redefinitions occur */
+int DEF_NUM = 23; /** The number of built-in functions (usefull for iteration)*/
+
+__thread Context* context = NULL; /** The interpreter evaluating on this thread, inherited by the threads it forks */
+__thread long* forkCounter = NULL; /** The fork counter of the innermost timing in progress on this thread, inherited by the threads it forks */
+
+/**
+ * Defines a value being evaluated, linked to the values whose evaluation needed it.
+ */
+typedef struct Forcing {
+  SymbolIdent* symbol; /** The value */
+  struct Forcing* outer; /** The value being evaluated when this one was needed, NULL if none */
+} Forcing;
+
+__thread Forcing* forcing = NULL; /** The innermost value the thread evaluates, inherited by the threads it forks */
+
+/**
+ * Evaluates a addition operation between two vals
+ * @return: a val with value equal to the sum of the arguments
+ */
+Val evalPlus(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_PLUS, 0, 0);
+  return createVal(ValueType_INT, getIntVal(arg1)+getIntVal(arg2));
+}
+
+/**
+ * Evaluates a subtraction operation between two vals
+ * @return: a val with value equal to the first argument minus the second
+ */
+Val evalMinus(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_MINUS, 0, 0);
+  return createVal(ValueType_INT, getIntVal(arg1)-getIntVal(arg2));
+}
+
+/**
+ * Evaluates a division operation between two vals
+ * @return: a val with value equal to the first argument divided by the second
+ */
+Val evalDiv(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_DIVIDE, 0, 0);
+  if (!getIntVal(arg2) && speculationAbort())
+    return createVal(ValueType_INT, 0);
+  return createVal(ValueType_INT, getIntVal(arg1)/getIntVal(arg2));
+}
+
+/**
+ * Evaluates a multiplication operation between two vals
+ * @return: a val with value equal to the product of the arguments
+ */
+Val evalMult(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_MULT, 0, 0);
+  return createVal(ValueType_INT, getIntVal(arg1)*getIntVal(arg2));
+}
+
+/**
+ * Evaluates an equality operation between two vals
+ * @return: a val with value 0 if the two vals are not equal, and with value 1 otherwise
+ */
+Val evalEqual(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_EQUAL, 0, 0);
+  if(getType(arg1) == ValueType_INT && getType(arg2) == ValueType_INT){
+    return createVal(ValueType_INT, getCharVal(arg1) == getCharVal(arg2));
+  }
+  else if(getType(arg1) == ValueType_LIST && getType(arg2) == ValueType_LIST){
+    return createVal(ValueType_INT, getListsEqual(arg1, arg2));
+  }
+  else if(getType(arg1) == ValueType_VECTOR && getType(arg2) == ValueType_VECTOR){
+    return createVal(ValueType_INT, getVectorsEqual(arg1, arg2));
+  }
+  else{
+    return createVal(ValueType_INT, 0);
+  }
+}
+
+/**
+ * Evaluates a header operation on a list
+ * @return: the value of the first node in the list
+ */
+Val evalHead(Val arg) {
+  TRACE2(TraceEvent_HEAD, 0, 0);
+  if (getType(arg) == ValueType_VECTOR) {
+    if (!speculationAbort())
+      printf("hd needs a list\n");
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  }
+  if ((getType(arg) != ValueType_LIST || !getListVal(arg)) && speculationAbort())
+    return createVal(ValueType_INT, 0);
+  return getListVal(arg)->value;
+}
+
+/**
+ * Evaluates a tail operation on a list
+ * @return: a new value pointing to the second node of the list
+ */
+Val evalTail(Val arg) {
+  TRACE2(TraceEvent_TAIL, 0, 0);
+  if (getType(arg) == ValueType_VECTOR) {
+    if (!speculationAbort())
+      printf("tl needs a list\n");
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  }
+  if ((getType(arg) != ValueType_LIST || !getListVal(arg)) && speculationAbort())
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  return createVal(ValueType_LIST, (intptr_t) getNextNode(getListVal(arg)));
+}
+
+/**
+ * Evaluates a length operation on a list or a vector
+ * @return: the length of the list, or the number of elements of the vector
+ */
+Val evalLength(Val arg) {
+  TRACE2(TraceEvent_LENGTH, 0, 0);
+  return createVal(ValueType_INT, getListLength(arg));
+}
+
+/**
+ * Builds a listnode using a value and a list, the new node has the value of the argument value and has the first node of the argument list as its tail
+ * @return: a new value pointing to the newly constructed node
+ */
+Val evalCons(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_CONS, 0, 0);
+  if (getType(arg2) == ValueType_VECTOR) {
+    if (!speculationAbort())
+      printf("cons needs a list\n");
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  }
+  statsAdd(StatCounter_CONS_CELLS, 1);
+  statsAdd(StatCounter_CONS_BYTES, sizeof(ValList));
+  if (profiling)
+    profileCons();
+  return createVal(ValueType_LIST, (intptr_t) createListNode(arg1, getListVal(arg2)));
+}
+
+/**
+ * Computes the node following a node of a range
+ * @return: a new lazy node holding the next number, or NULL if the range is exhausted
+ */
+ValList* rangeNext(ListThunk* thunk) {
+  intptr_t value = getIntVal(thunk->current) + 1;
+  if (value >= thunk->limit)
+    return NULL;
+  ListThunk generator = *thunk;
+  generator.current = createVal(ValueType_INT, value);
+  generator.length = thunk->length - 1;
+  return createLazyListNode(generator.current, &generator);
+}
+
+/**
+ * Builds the list of all numbers from the first argument up to, but not including, the second. The nodes are created as the list is traversed and kept once created, so traversing the whole range holds all of it in memory
+ * @return: a new value pointing to the first node of the range, or the empty list
+ */
+Val evalRange(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_RANGE, 0, 0);
+  if (getIntVal(arg1) >= getIntVal(arg2))
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  ListThunk generator = {rangeNext, getIntVal(arg2) - getIntVal(arg1) - 1, arg1, getIntVal(arg2), NULL, NULL, ThunkState_PENDING};
+  return createVal(ValueType_LIST, (intptr_t) createLazyListNode(arg1, &generator));
+}
+
+/**
+ * Obtains the vector a builtin works on, building one from the elements of a list
+ * @param: The name of the builtin, and its argument
+ * @return: the vector, or NULL if the argument is neither a vector nor a list
+ */
+static Vector* vectorArgument(const char* name, Val arg) {
+  if (getType(arg) == ValueType_VECTOR)
+    return getVectorVal(arg);
+  if (getType(arg) != ValueType_LIST) {
+    if (!speculationAbort())
+      printf("%s needs a vector\n", name);
+    return NULL;
+  }
+  Vector* vector = createVector(getListLength(arg));
+  intptr_t i = 0;
+  for (ValList* node = getListVal(arg); node; node = getNextNode(node))
+    vector->elements[i++] = node->value;
+  return vector;
+}
+
+/**
+ * Evaluates an indexing operation on a vector
+ * @return: the element at the index, counting from 0, or the empty list if there is none
+ */
+Val evalNth(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_NTH, 0, 0);
+  Vector* vector = vectorArgument("nth", arg1);
+  if (!vector)
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  if (getIntVal(arg2) < 0 || getIntVal(arg2) >= vector->length) {
+    if (!speculationAbort())
+      printf("nth needs an index within the vector\n");
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  }
+  return vector->elements[getIntVal(arg2)];
+}
+
+/**
+ * Builds a view of the elements of a vector from an index up to, but not including, another, sharing the elements
+ * @return: a new value pointing to the slice
+ */
+Val evalSlice(Val arg1, Val arg2, Val arg3) {
+  TRACE2(TraceEvent_SLICE, 0, 0);
+  Vector* vector = vectorArgument("slice", arg1);
+  if (!vector)
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  return createVal(ValueType_VECTOR, (intptr_t) createSlice(vector, getIntVal(arg2), getIntVal(arg3)));
+}
+
+/**
+ * Builds a vector of the elements of one vector followed by the elements of another
+ * @return: a new value pointing to the new vector
+ */
+Val evalConcat(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_CONCAT, 0, 0);
+  Vector* first = vectorArgument("concat", arg1);
+  Vector* second = first ? vectorArgument("concat", arg2) : NULL;
+  if (!second)
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  Vector* vector = createVector(first->length + second->length);
+  memcpy(vector->elements, first->elements, sizeof(Val) * first->length);
+  memcpy(vector->elements + first->length, second->elements, sizeof(Val) * second->length);
+  return createVal(ValueType_VECTOR, (intptr_t) vector);
+}
+
+/**
+ * Evaluates a length operation on a vector, or on a list
+ * @return: the number of elements
+ */
+Val evalLen(Val arg) {
+  TRACE2(TraceEvent_LEN, 0, 0);
+  if (getType(arg) == ValueType_VECTOR)
+    return createVal(ValueType_INT, getVectorVal(arg)->length);
+  return createVal(ValueType_INT, getListLength(arg));
+}
+
+/**
+ * Builds a vector of the elements of a list, vectors are returned as they are
+ * @return: a new value pointing to the vector
+ */
+Val evalToVector(Val arg) {
+  TRACE2(TraceEvent_TOVECTOR, 0, 0);
+  Vector* vector = vectorArgument("tovector", arg);
+  if (!vector)
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  return createVal(ValueType_VECTOR, (intptr_t) vector);
+}
+
+/**
+ * Computes the node following a node of a list built from a vector
+ * @return: a new lazy node holding the next element, or NULL after the last element
+ */
+ValList* vectorNext(ListThunk* thunk) {
+  Vector* vector = (Vector*) thunk->source;
+  intptr_t index = thunk->limit + 1;
+  if (index >= vector->length)
+    return NULL;
+  ListThunk generator = *thunk;
+  generator.current = vector->elements[index];
+  generator.limit = index;
+  generator.length = vector->length - index - 1;
+  return createLazyListNode(generator.current, &generator);
+}
+
+/**
+ * Builds the list of the elements of a vector, lists are returned as they are. The nodes are created as the list is traversed
+ * @return: a new value pointing to the first node of the list, or the empty list
+ */
+Val evalToList(Val arg) {
+  TRACE2(TraceEvent_TOLIST, 0, 0);
+  if (getType(arg) != ValueType_VECTOR)
+    return arg;
+  Vector* vector = getVectorVal(arg);
+  if (!vector->length)
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  ListThunk generator = {vectorNext, vector->length - 1, vector->elements[0], 0, vector, NULL, ThunkState_PENDING};
+  return createVal(ValueType_LIST, (intptr_t) createLazyListNode(vector->elements[0], &generator));
+}
+
+/**
+ * Evaluates the body of a user-defined function with its arguments bound, recording the call if profiling
+ * @return: The value of the function body
+ */
+Val evalSymbol(SymbolIdent* symbol, ArgName arguments[], int k) {
+  statsAdd(StatCounter_CALLS, 1);
+  if (speculation && speculationCancelled())
+    return createVal(ValueType_INT, 0);
+  Val result;
+  if (!symbol->argNames) {
+    if (!profiling)
+      return evalValue(symbol);
+    profileEnter(symbol);
+    result = evalValue(symbol);
+    profileExit();
+    return result;
+  }
+  //Threads forked to evaluate arguments call the same symbols, so exactly one of them sees the count reach the threshold
+  if (jitEnabled && !symbol->native && symbol->calls >= 0 && __sync_add_and_fetch(&symbol->calls, 1) == JIT_THRESHOLD)
+    jitCompile(symbol);
+  if (symbol->native && !speculation && jitCall(symbol, arguments, k, &result))
+    return result;
+  if (typing && !symbol->typed)
+    inferTypes(symbol);
+  Val (*evaluate)(TreeNode*, ArgName[], int) = eval;
+  if (typing && symbol->typed > 0) {
+    evaluate = evalTyped;
+    for (int i = 0; i < k && i < 32 && evaluate == evalTyped; i++) {
+      if ((symbol->intArgs >> i & 1) && (arguments[i].thunk || getType(arguments[i].value) != ValueType_INT))
+	evaluate = eval;
+    }
+  }
+  if (!profiling)
+    return evaluate(symbol->parseTree, arguments, k);
+  profileEnter(symbol);
+  result = evaluate(symbol->parseTree, arguments, k);
+  profileExit();
+  return result;
+}
+
+/**
+ * Obtains the value of a user-defined value, evaluating it the first time it is used
+ * @param: The value
+ * @return: The value, or the empty list if it is defined in terms of itself
+ */
+Val evalValue(SymbolIdent* symbol) {
+  while (symbol->expression && symbol->state != ThunkState_DONE) {
+    for (Forcing* outer = forcing; outer; outer = outer->outer) {
+      if (outer->symbol == symbol) {
+	printf("%s is defined in terms of itself\n", symbol->name);
+	return createVal(ValueType_LIST, (intptr_t) NULL);
+      }
+    }
+    if (__sync_bool_compare_and_swap(&symbol->state, ThunkState_PENDING, ThunkState_FORCING)) {
+      Forcing current = {symbol, forcing};
+      forcing = &current;
+      Val value = evalCached(symbol->expression);
+      forcing = current.outer;
+      if (speculationCancelled()) {
+	//The value is thrown away, whoever needs it evaluates it again
+	symbol->state = ThunkState_PENDING;
+	return value;
+      }
+      symbol->parseTree->value = value;
+      __sync_synchronize();
+      symbol->state = ThunkState_DONE;
+    }
+    else
+      sched_yield();
+  }
+  return symbol->parseTree->value;
+}
+
+/**
+ * Calls a user-defined function with already evaluated arguments
+ * @param: The function, and an array of the values of its arguments in order
+ * @return: The value of the function body
+ */
+Val callSymbol(SymbolIdent* symbol, Val values[]) {
+  int k = 0;
+  NameListNode* count_temp = symbol->argNames;
+  while (count_temp) {
+    k++;
+    count_temp = count_temp->next;
+  }
+  count_temp = symbol->argNames;
+  ArgName arguments[k];
+  for (int l = 0; l < k; l++) {
+    arguments[l].value = values[l];
+    arguments[l].ident = count_temp->name;
+    arguments[l].thunk = NULL;
+    count_temp = count_temp->next;
+  }
+  return evalSymbol(symbol, arguments, k);
+}
+
+/**
+ * Computes the node following a node of an iteration by applying the function to its value
+ * @return: a new lazy node holding the next value
+ */
+ValList* iterateNext(ListThunk* thunk) {
+  ListThunk generator = *thunk;
+  //The list may be forced by whoever reads it, so the function runs in the interpreter that built the list
+  Context* caller = context;
+  context = thunk->context;
+  generator.current = callSymbol((SymbolIdent*) thunk->source, &thunk->current);
+  context = caller;
+  if (speculationCancelled()) {
+    //The value is thrown away, whoever reads the list forces the node again
+    thunk->state = ThunkState_PENDING;
+    return NULL;
+  }
+  return createLazyListNode(generator.current, &generator);
+}
+
+/**
+ * Builds the infinite list start, f(start), f(f(start))... The nodes are created as the list is traversed and kept once created, so memory grows with how far the list is read
+ * @param: The name of a user-defined function of one argument, and the first value
+ * @return: a new value pointing to the first node of the iteration, or the empty list if the function does not exist
+ */
+Val evalIterate(char* name, Val start) {
+  TRACE2(TraceEvent_ITERATE, 0, 0);
+  SymbolIdent* symbol;
+  if (hashmap_get(context->symbols, name, (any_t*) &symbol) != MAP_OK ||
+      !symbol->argNames || symbol->argNames->next) {
+    printf("iterate needs a function of one argument\n");
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  }
+  ListThunk generator = {iterateNext, -1, start, 0, symbol, context, ThunkState_PENDING};
+  return createVal(ValueType_LIST, (intptr_t) createLazyListNode(start, &generator));
+}
+
+/**
+ * Obtains the time of a clock
+ * @return: the time in nanoseconds
+ */
+intptr_t clockNs(clockid_t clock) {
+  struct timespec t = {0,0};
+  clock_gettime(clock, &t);
+  return (intptr_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/**
+ * Evaluates a tree and measures the evaluation. Threads forked while the tree is evaluated, directly or by threads forked from it, are counted
+ * @param: The tree to be measured, the local symbol bindings and their number, and wether to return all measurements or the wall time only
+ * @return: the wall time in nanoseconds, or if detailed the list [wall time, process processor time, threads forked], times in nanoseconds
+ */
+Val evalTiming(TreeNode* target, ArgName args[], int argNum, int detailed) {
+  long forks = 0;
+  long* outerCounter = forkCounter;
+  forkCounter = &forks;
+  intptr_t cpuStart = clockNs(CLOCK_PROCESS_CPUTIME_ID);
+  intptr_t wallStart = clockNs(CLOCK_MONOTONIC);
+  eval(target, args, argNum);
+  intptr_t wall = clockNs(CLOCK_MONOTONIC) - wallStart;
+  intptr_t cpu = clockNs(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+  forkCounter = outerCounter;
+  if (outerCounter)
+    __sync_fetch_and_add(outerCounter, forks);
+  if (!detailed)
+    return createVal(ValueType_INT, wall);
+  ValList* result = createListNode(createVal(ValueType_INT, forks), NULL);
+  result = createListNode(createVal(ValueType_INT, cpu), result);
+  result = createListNode(createVal(ValueType_INT, wall), result);
+  return createVal(ValueType_LIST, (intptr_t) result);
+}
+
+/**
+ * Builds the list of the runtime statistics, the counters in the order of StatCounter followed by the peak number of threads
+ * @return: a new value pointing to the list
+ */
+Val evalStats() {
+  TRACE2(TraceEvent_STATS, 0, 0);
+  long counts[StatCounter_NUM];
+  int peak = statsSnapshot(counts);
+  ValList* result = createListNode(createVal(ValueType_INT, peak), NULL);
+  for (int i = StatCounter_NUM - 1; i >= 0; i--)
+    result = createListNode(createVal(ValueType_INT, counts[i]), result);
+  return createVal(ValueType_LIST, (intptr_t) result);
+}
+
+/**
+ * Evaluates wether a value is lesser than another, for ints this is a standard comparison Arg1<Arg2, for lists this compares the lengths of the lists.
+ * @return: a new value with value 1 if the first argument is lesser than the second, 0 otherwise. If the arguments are of different types, a new value with value 0 is returned.
+ */
+Val evalLesser(Val arg1, Val arg2) {
+  TRACE2(TraceEvent_LESSER, 0, 0);
+  if(getType(arg1) == ValueType_INT && getType(arg2) == ValueType_INT){
+    return createVal(ValueType_INT, (getIntVal(arg1) < getIntVal(arg2)));
+  }
+  else if(getType(arg1) == ValueType_LIST && getType(arg2) == ValueType_LIST){
+    return createVal(ValueType_INT, (getListLength(arg1) < getListLength(arg2)));
+  }
+  else if(getType(arg1) == ValueType_VECTOR && getType(arg2) == ValueType_VECTOR){
+    return createVal(ValueType_INT, (getVectorVal(arg1)->length < getVectorVal(arg2)->length));
+  }
+  else{
+    return createVal(ValueType_INT, 0);
+  }
+}
+
+/**
+ * Examines wether a string is equal to the identifier of one of the pre-defined functions
+ * @return: 1 if the string is one of the pre-defined ones, 0 otherwise
+ */
+int exists(const char* str) {
+  for (int i = 0; i < DEF_NUM; i++) {
+    if (!strcmp(str,DEF_FUN[i]))
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * Examines whether a call of a built-in that takes the name of a function is well-formed
+ * @param: The call, the number of arguments it needs, and the index of the argument that must be a name
+ * @return: 1 if the call has that many arguments and a name at that index, 0 otherwise
+ */
+int namesFunction(TreeNode* node, int num, int index) {
+  int i = 0;
+  for (PointerListNode* argument = node->argList; argument; argument = argument->next, i++) {
+    if (i == index && getType(argument->target->value) != ValueType_CONSTANT)
+      return 0;
+  }
+  return i == num;
+}
+
+/**
+ * Evaluates the arguments of a node, the ones that call user-defined functions on threads of their own while there are threads left
+ * @param: The node, the local symbol bindings and their number, where to store the values and the number of arguments, whether to evaluate the arguments not forked along their typed paths, and the arguments to leave unevaluated as a bit mask
+ */
+static void evalArguments(TreeNode* curr, ArgName args[], int argNum, ThreadTuple argList[], int i, int typed, unsigned suspended) {
+  ForkArgs forkArgs[i];
+  PointerListNode* temp = curr->argList;
+  int ignore = 1;
+  for (int j = 0; j < i; j++) {
+    argList[j].id = 0;
+    if (j < 32 && (suspended >> j & 1)) {
+      temp = temp->next;
+      continue;
+    }
+    forkArgs[j].target = temp->target;
+    forkArgs[j].args = args;
+    forkArgs[j].num = argNum;
+    forkArgs[j].returnVal = &(argList[j].value);
+    forkArgs[j].task = NULL;
+    if (checkFork(&(forkArgs[j]))) {
+      if (ignore) {
+	ignore = 0;
+	argList[j].id = 0;
+      }
+      else
+	argList[j].id = doFork(&(forkArgs[j]));
+    }
+    else
+      argList[j].id = 0;
+    temp = temp->next;
+  }
+  temp = curr->argList;
+  for (int j = 0; j < i; j++) {
+    if (!argList[j].id && !(j < 32 && (suspended >> j & 1))) {
+      argList[j].value = typed ? evalTyped(temp->target,args,argNum) : eval(temp->target,args,argNum);
+    }
+    temp = temp->next;
+  }
+  void* bogus;
+  for (int j = 0; j < i; j++) {
+    if (argList[j].id) {
+      pthread_join(argList[j].id, &bogus);
+    }
+  }
+}
+
+/**
+ * Computes an int operation of two ints
+ * @return: the result
+ */
+static intptr_t intOperation(char operation, intptr_t arg1, intptr_t arg2) {
+  switch (operation) {
+  case IntOperation_PLUS: return arg1 + arg2;
+  case IntOperation_MINUS: return arg1 - arg2;
+  case IntOperation_MULT: return arg1 * arg2;
+  case IntOperation_DIVIDE: return !arg2 && speculationAbort() ? 0 : arg1 / arg2;
+  case IntOperation_EQUALS: return arg1 == arg2;
+  case IntOperation_LESSER: return arg1 < arg2;
+  default: return arg1 > arg2;
+  }
+}
+
+/**
+ * Examines a node for an idiom the first time it is evaluated
+ * @return: nonzero if the node is evaluated as a fused idiom
+ */
+static int fused(TreeNode* curr) {
+  if (curr->idiom == Idiom_UNEXAMINED)
+    curr->idiom = findIdiom(curr);
+  return curr->idiom > 0;
+}
+
+/**
+ * Evaluates a pure tree, which only computes with int constants and int arguments
+ * @param: The tree, and the local symbol bindings
+ * @return: The int the tree evaluates to
+ */
+static intptr_t evalInt(TreeNode* curr, ArgName args[]) {
+  PointerListNode* children = curr->argList;
+  switch (curr->operation) {
+  case IntOperation_CONSTANT:
+    return getIntVal(curr->value);
+  case IntOperation_ARGUMENT:
+    return getIntVal(args[curr->argument].value);
+  case IntOperation_ITE:
+    if (evalInt(children->target, args))
+      return evalInt(children->next->target, args);
+    return evalInt(children->next->next->target, args);
+  default:
+    return intOperation(curr->operation, evalInt(children->target, args), evalInt(children->next->target, args));
+  }
+}
+
+/**
+ * Evaluates a parse tree of a function whose types have been inferred, called with ints for the arguments assumed to be ints
+ * @param: The tree to be evaluated, an array of the local symbol bindings, and the number of local symbol bindings
+ * @return: The values that the tree evaluates to
+ */
+Val evalTyped(TreeNode* curr, ArgName args[], int argNum) {
+  if (curr->pure)
+    return createVal(ValueType_INT, evalInt(curr, args));
+  switch (curr->operation) {
+  case IntOperation_NONE:
+    return eval(curr, args, argNum);
+  case IntOperation_ITE: {
+    PointerListNode* children = curr->argList;
+    if (evalTyped(children->target, args, argNum).value.intval)
+      return evalTyped(children->next->target, args, argNum);
+    return evalTyped(children->next->next->target, args, argNum);
+  }
+  default: {
+    if (fused(curr))
+      return evalIdiom(curr, args, argNum);
+    ThreadTuple argList[2];
+    evalArguments(curr, args, argNum, argList, 2, 1, 0);
+    return createVal(ValueType_INT, intOperation(curr->operation, getIntVal(argList[0].value), getIntVal(argList[1].value)));
+  }
+  }
+}
+
+/**
+ * Finds the arguments of a call that lazy mode leaves unevaluated: calls, and arguments passed on that are bound to thunks, where the called function may not evaluate them
+ * @param: The node of the call, the local symbol bindings and their number, and where to store the called function, which is NULL if it is not defined
+ * @return: the arguments as a bit mask, 0 if they are all evaluated as usual
+ */
+static unsigned suspendedArguments(TreeNode* curr, ArgName args[], int argNum, SymbolIdent** symbol) {
+  statsAdd(StatCounter_LOOKUPS, 1);
+  if (hashmap_get(context->symbols, getCharVal(curr->value), (any_t*) symbol) != MAP_OK) {
+    *symbol = NULL;
+    return 0;
+  }
+  if (!(*symbol)->strictness)
+    analyseStrictness(*symbol);
+  unsigned suspended = 0;
+  int j = 0;
+  for (PointerListNode* temp = curr->argList; temp && j < 32; temp = temp->next, j++) {
+    if ((*symbol)->strictArgs >> j & 1)
+      continue;
+    if (getType(temp->target->value) == ValueType_FUNCTION)
+      suspended |= 1u << j;
+    else if (getType(temp->target->value) == ValueType_CONSTANT) {
+      for (int k = 0; k < argNum; k++) {
+	if (!strcmp(getCharVal(temp->target->value),args[k].ident)) {
+	  if (args[k].thunk)
+	    suspended |= 1u << j;
+	  break;
+	}
+      }
+    }
+  }
+  return suspended;
+}
+
+/**
+ * Calls a user-defined function in lazy mode. Its strict arguments are evaluated first, the others are bound to thunks, except that arguments passed on unevaluated share the thunk they are bound to.
+ * Calls that suspend nothing take the usual path of eval instead, so they need no room for thunks
+ * @param: The node of the call, the local symbol bindings and their number, the called function, and the suspended arguments as found by suspendedArguments
+ * @return: The value of the function body
+ */
+static Val evalLazyCall(TreeNode* curr, ArgName args[], int argNum, SymbolIdent* symbolGot, unsigned suspended) {
+  TRACE2(TraceEvent_ARGUMENTS, 0, 0);
+  int i = 0;
+  PointerListNode* temp = curr->argList;
+  while (temp) {temp = temp->next; i++;}
+  ThreadTuple argList[i];
+  Thunk thunks[i];
+  ArgName passed[i];
+  temp = curr->argList;
+  for (int j = 0; j < i && j < 32; j++) {
+    if (suspended >> j & 1) {
+      if (getType(temp->target->value) == ValueType_FUNCTION) {
+	thunks[j].target = temp->target;
+	thunks[j].args = args;
+	thunks[j].num = argNum;
+	thunks[j].state = ThunkState_PENDING;
+	passed[j].thunk = &thunks[j];
+      }
+      else {
+	//An argument passed on keeps its binding
+	for (int k = 0; k < argNum; k++) {
+	  if (!strcmp(getCharVal(temp->target->value),args[k].ident)) {
+	    passed[j] = args[k];
+	    break;
+	  }
+	}
+      }
+    }
+    temp = temp->next;
+  }
+  evalArguments(curr, args, argNum, argList, i, 0, suspended);
+  int k = 0;
+  NameListNode* count_temp = symbolGot->argNames;
+  while (count_temp) {
+    k++;
+    count_temp = count_temp->next;
+  }
+  count_temp = symbolGot->argNames;
+  ArgName arguments[k];
+  for (int l = 0; l < k; l++) {
+    if (l < 32 && (suspended >> l & 1))
+      arguments[l] = passed[l];
+    else {
+      arguments[l].value = argList[l].value;
+      arguments[l].thunk = NULL;
+    }
+    arguments[l].ident = count_temp->name;
+    count_temp = count_temp->next;
+  }
+  TRACE1(TraceEvent_CALL, symbolGot->name, 0);
+  return evalSymbol(symbolGot,arguments,k);
+}
+
+/**
+ * Recursively evaluates a parse tree
+ * @param: The tree to be evaluated, an array of the local symbol bindings, and the number of local symbol bindings
+ * @return: The values that the tree evaluates to
+ */
+Val eval(TreeNode* curr, ArgName args[], int argNum) {
+  TRACE2(TraceEvent_NODE, 0, 0);
+  SymbolIdent* symbolGot = NULL;
+  unsigned suspended;
+  statsAdd(StatCounter_NODES, 1);
+  switch (getType(curr->value)) {
+  case ValueType_CONSTANT:
+    for (int k=0; k < argNum; k++) {
+      if (!strcmp(getCharVal(curr->value),args[k].ident)) {
+	TRACE2(TraceEvent_ARGUMENT, args[k].ident, 0);
+	if (args[k].thunk)
+	  return forceThunk(args[k].thunk);
+	return args[k].value;
+      }
+    }
+  case ValueType_FUNCTION:
+    if (fused(curr))
+      return evalIdiom(curr, args, argNum);
+    if (!strcmp(getCharVal(curr->value),"ite")) {
+      TRACE2(TraceEvent_ITE, 0, 0);
+      Val speculated;
+      if (speculating && evalSpeculative(curr, args, argNum, &speculated))
+	return speculated;
+      Val branchBool = eval(getArgNode(curr,0), args, argNum);
+      if (branchBool.value.intval)
+	return eval(getArgNode(curr,1),args,argNum);
+      else
+	return eval(getArgNode(curr,2),args,argNum);
+    } else if (!strcmp(getCharVal(curr->value),"time")) {
+      TRACE2(TraceEvent_TIME, 0, 0);
+      return evalTiming(getArgNode(curr,0), args, argNum, 0);
+    } else if (!strcmp(getCharVal(curr->value),"timing")) {
+      TRACE2(TraceEvent_TIMING, 0, 0);
+      return evalTiming(getArgNode(curr,0), args, argNum, 1);
+    } else if (!strcmp(getCharVal(curr->value),"iterate")) {
+      TRACE2(TraceEvent_ITERATE_CASE, 0, 0);
+      if (!namesFunction(curr, 2, 0)) {
+	if (!speculationAbort())
+	  printf("iterate needs the name of a function and a start value\n");
+	return createVal(ValueType_LIST, (intptr_t) NULL);
+      }
+      return evalIterate(getCharVal(getArgNode(curr,0)->value), eval(getArgNode(curr,1), args, argNum));
+    } else if (!strcmp(getCharVal(curr->value),"sort")) {
+      //The comparator is the name of a function, not an argument to evaluate
+      if (!namesFunction(curr, 1, -1) && !namesFunction(curr, 2, 1)) {
+	if (!speculationAbort())
+	  printf("sort needs a list and the name of a function\n");
+	return createVal(ValueType_LIST, (intptr_t) NULL);
+      }
+      return evalSort(eval(getArgNode(curr,0), args, argNum), curr->argList->next ? getCharVal(getArgNode(curr,1)->value) : NULL);
+    } else if (lazy && !exists(getCharVal(curr->value)) &&
+	       (suspended = suspendedArguments(curr, args, argNum, &symbolGot))) {
+      return evalLazyCall(curr, args, argNum, symbolGot, suspended);
+    } else { //Execute arguments
+      TRACE2(TraceEvent_ARGUMENTS, 0, 0);
+      int i = 0;
+      PointerListNode* temp = curr->argList;
+      while (temp) {temp = temp->next; i++;}
+      ThreadTuple argList[i];
+      evalArguments(curr, args, argNum, argList, i, 0, 0);      
+      if (!strcmp(getCharVal(curr->value),"plus")) {
+	return evalPlus(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"minus")) {
+	return evalMinus(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"mult")) {
+	return evalMult(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"divide")) {
+	return evalDiv(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"equals")) {
+	return evalEqual(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"hd")) {
+	return evalHead(argList[0].value);
+      } else if (!strcmp(getCharVal(curr->value),"tl")) {
+	return evalTail(argList[0].value);
+      } else if (!strcmp(getCharVal(curr->value),"length")) {
+	return evalLength(argList[0].value);
+      } else if (!strcmp(getCharVal(curr->value),"cons")) {
+	return evalCons(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"range")) {
+	return evalRange(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"lesser")) {
+	return evalLesser(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"greater")) {
+	return evalLesser(argList[1].value,argList[0].value);
+      } else if (!strcmp(getCharVal(curr->value),"stats")) {
+	return evalStats();
+      } else if (!strcmp(getCharVal(curr->value),"nth")) {
+	return evalNth(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"slice")) {
+	return evalSlice(argList[0].value,argList[1].value,argList[2].value);
+      } else if (!strcmp(getCharVal(curr->value),"concat")) {
+	return evalConcat(argList[0].value,argList[1].value);
+      } else if (!strcmp(getCharVal(curr->value),"len")) {
+	return evalLen(argList[0].value);
+      } else if (!strcmp(getCharVal(curr->value),"tovector")) {
+	return evalToVector(argList[0].value);
+      } else if (!strcmp(getCharVal(curr->value),"tolist")) {
+	return evalToList(argList[0].value);
+      } else {
+	//Lazy mode has already looked up a function whose arguments are all evaluated
+	if (!symbolGot) {
+	  statsAdd(StatCounter_LOOKUPS, 1);
+	  if (hashmap_get(context->symbols, getCharVal(curr->value),&symbolGot) != MAP_OK) {
+	    printf("%s is not defined\n", getCharVal(curr->value));
+	    return createVal(ValueType_LIST, (intptr_t) NULL);
+	  }
+	}
+	int k = 0;
+	NameListNode* count_temp = symbolGot->argNames;
+	while (count_temp) {
+	  k++;
+	  count_temp = count_temp->next;
+	}
+	count_temp = symbolGot->argNames;
+	ArgName arguments[k];
+	for (int l = 0; l < k; l++) {
+	  arguments[l].value = argList[l].value;
+	  arguments[l].ident = count_temp->name;
+	  arguments[l].thunk = NULL;
+	  count_temp = count_temp->next;
+	}
+	TRACE1(TraceEvent_CALL, symbolGot->name, 0);
+	return evalSymbol(symbolGot,arguments,k);
+      }
+      break;
+    }
+  case ValueType_INT:
+  case ValueType_LIST:
+  case ValueType_VECTOR:
+    TRACE2(TraceEvent_CONSTANT, getType(curr->value), curr->value.value.intval);
+    return curr->value;
+  }
+}
+
+/**
+ * This function is the one which is called when creating a new thread.
+ * @return: Always return 0
+ */
+void* prepSeqEval(void* arguments) {
+  ForkArgs* args = (ForkArgs*) arguments;
+  forkCounter = args->forkCounter;
+  context = args->context;
+  speculation = args->speculation;
+  forcing = args->forcing;
+  if (speculation)
+    speculationStart((char*) &args);
+  if (profiling)
+    profileStartThread(args->profileOrigin);
+  if (args->task)
+    args->task(args->data);
+  else
+    *(args->returnVal) = eval(args->target, args->args, args-> num);
+  TRACE1(TraceEvent_FINISHED, args->target, 0);
+  __sync_fetch_and_sub(&context->numThreads, 1);
+  statsThreadExit();
+  traceThreadExit();
+  return 0;
+}
+
+/**
+ * Creates a new thread
+ * @param: The arguments for the new thread
+ * @return: The thread id of the new thread
+ */
+pthread_t doFork(ForkArgs* args) {
+  pthread_t tid;
+  args->forkCounter = forkCounter;
+  args->context = context;
+  args->speculation = speculation;
+  args->forcing = forcing;
+  if (forkCounter)
+    __sync_fetch_and_add(forkCounter, 1);
+  if (profiling) {
+    profileFork();
+    args->profileOrigin = profilePosition();
+  }
+  statsThreads(__sync_add_and_fetch(&context->numThreads, 1));
+  statsAdd(StatCounter_FORKS_TAKEN, 1);
+  pthread_create(&tid, NULL, prepSeqEval, args);
+  TRACE1(TraceEvent_CREATED, tid, args->target);
+  return tid;
+}
+
+/**
+ * Evaluates wether a new thread should be created
+ * @param: The arguments the new thread would have
+ * @return: 1 if a new thread should be created, 0 otherwise
+ */
+int checkFork(ForkArgs* args)
+{
+  if (getType(args->target->value) == ValueType_FUNCTION && !exists(args->target->value.value.identifier)) {
+    statsAdd(StatCounter_FORKS_ATTEMPTED, 1);
+    if (context->numThreads < context->maxThreads)
+      return 1;
+    statsAdd(StatCounter_FORKS_REJECTED, 1);
+  }
+  return 0; 
+}
+
@@ -0,0 +1,214 @@
+/**
+ * @brief: This is the header file for the evaluator, containing the structures used to bind arguments and create threads, and the functions that evaluate parse trees
+ * @file: eval.h
+ * @author: Jonatan Waern, Daniel Engh, Adam Olevall, Mikael Holmberg
+ * @date: 27/6 2013
+ */
+
+#ifndef EVAL_HEADER
+#define EVAL_HEADER
+#include "structures.h"
+#include "hashmap.h"
+#include <pthread.h>
+#include <stdio.h>
+
+extern char* DEF_FUN[]; /** These are the names of all the built-in functions */
+extern int DEF_NUM; /** The number of built-in functions */
+
+/**
+ * This defines an interpreter instance.
+ * Defines the symbols an interpreter has defined and the threads it may use, several contexts can evaluate at once in one process
+ */
+typedef struct Context {
+  map_t symbols; /** This hashmap stores all user-defined functions and symbols */
+  int maxThreads; /** Maximum number of threads */
+  volatile int numThreads; /** Current number of threads */
+} Context;
+
+extern __thread Context* context; /** The interpreter evaluating on this thread, inherited by the threads it forks */
+
+/**
+ * This defines a tuple of thread id's and values.
+ * Defines a tuple of thread id's and values, used to store returnvalues from threads
+ */
+typedef struct {
+  pthread_t id; /** Id of thread */
+  Val value; /** Returnvalue of thread */
+} ThreadTuple;
+
+/**
+ * This defines a tuple of values and strings.
+ * Defines a tuple of char* and values, used to bind certain identifiers to certain values
+ */
+typedef struct {
+  Val value; /** The Value */
+  char* ident; /** The identifier */
+  struct Thunk* thunk; /** The suspended computation of the value in lazy mode, NULL if the value is known */
+} ArgName;
+
+/**
+ * This defines a tuple of various types to be used when passing arguments to thread creation.
+ * Defines a tuple of TreeNode*, ArgName*, int and Val*. Used as a struct to pass through a void*
+ */
+typedef struct {
+  TreeNode* target; /** The ParseTree that the new thread will execute */
+  ArgName* args; /** An array of ArgName structs that defines the stack bindings for the new walk */
+  int num; /** The size of args */
+  Val* returnVal; /** A pointer of where to write the result of the walk */
+  long* forkCounter; /** The fork counter of the timing the new thread runs under, if any */
+  void* profileOrigin; /** The position in the profiled call tree the new thread was forked from, if profiling */
+  Context* context; /** The interpreter the new thread evaluates for */
+  struct Speculation* speculation; /** The speculation the new thread evaluates for, if any */
+  struct Forcing* forcing; /** The values being evaluated by the thread forking the new thread, if any */
+  void (*task)(void*); /** A function the new thread runs instead of evaluating target, NULL to evaluate target */
+  void* data; /** The argument of the task */
+} ForkArgs;
+
+/**
+ * Evaluates a addition operation between two vals
+ * @return: a val with value equal to the sum of the arguments
+ */
+Val evalPlus(Val arg1, Val arg2);
+/**
+ * Evaluates a subtraction operation between two vals
+ * @return: a val with value equal to the first argument minus the second
+ */
+Val evalMinus(Val arg1, Val arg2);
+/**
+ * Evaluates a division operation between two vals
+ * @return: a val with value equal to the first argument divided by the second
+ */
+Val evalDiv(Val arg1, Val arg2);
+/**
+ * Evaluates a multiplication operation between two vals
+ * @return: a val with value equal to the product of the arguments
+ */
+Val evalMult(Val arg1, Val arg2);
+/**
+ * Evaluates an equality operation between two vals
+ * @return: a val with value 0 if the two vals are not equal, and with value 1 otherwise
+ */
+Val evalEqual(Val arg1, Val arg2);
+/**
+ * Evaluates a header operation on a list
+ * @return: the value of the first node in the list
+ */
+Val evalHead(Val arg);
+/**
+ * Evaluates a tail operation on a list
+ * @return: a new value pointing to the second node of the list
+ */
+Val evalTail(Val arg);
+/**
+ * Evaluates a length operation on a list
+ * @return: the length of the list
+ */
+Val evalLength(Val arg);
+/**
+ * Builds a listnode using a value and a list
+ * @return: a new value pointing to the newly constructed node
+ */
+Val evalCons(Val arg1, Val arg2);
+/**
+ * Builds the list of all numbers from the first argument up to, but not including, the second, creating the nodes as they are read and keeping them
+ * @return: a new value pointing to the first node of the range, or the empty list
+ */
+Val evalRange(Val arg1, Val arg2);
+/**
+ * Builds the infinite list start, f(start), f(f(start))..., creating the nodes as they are read and keeping them
+ * @return: a new value pointing to the first node of the iteration, or the empty list if the function does not exist
+ */
+Val evalIterate(char* name, Val start);
+/**
+ * Evaluates a tree and measures the evaluation
+ * @return: the wall time in nanoseconds, or if detailed the list [wall time, process processor time, threads forked], times in nanoseconds
+ */
+Val evalTiming(TreeNode* target, ArgName args[], int argNum, int detailed);
+/**
+ * Builds the list of the runtime statistics, the counters in the order of StatCounter followed by the peak number of threads
+ * @return: a new value pointing to the list
+ */
+Val evalStats();
+/**
+ * Evaluates wether a value is lesser than another
+ * @return: a new value with value 1 if the first argument is lesser than the second, 0 otherwise
+ */
+Val evalLesser(Val arg1, Val arg2);
+/**
+ * Evaluates an indexing operation on a vector
+ * @return: the element at the index, counting from 0, or the empty list if there is none
+ */
+Val evalNth(Val arg1, Val arg2);
+/**
+ * Builds a view of the elements of a vector from an index up to, but not including, another, sharing the elements
+ * @return: a new value pointing to the slice
+ */
+Val evalSlice(Val arg1, Val arg2, Val arg3);
+/**
+ * Builds a vector of the elements of one vector followed by the elements of another
+ * @return: a new value pointing to the new vector
+ */
+Val evalConcat(Val arg1, Val arg2);
+/**
+ * Evaluates a length operation on a vector, or on a list
+ * @return: the number of elements
+ */
+Val evalLen(Val arg);
+/**
+ * Builds a vector of the elements of a list, vectors are returned as they are
+ * @return: a new value pointing to the vector
+ */
+Val evalToVector(Val arg);
+/**
+ * Builds the list of the elements of a vector, lists are returned as they are
+ * @return: a new value pointing to the first node of the list, or the empty list
+ */
+Val evalToList(Val arg);
+/**
+ * Evaluates the body of a user-defined function with its arguments bound, recording the call if profiling
+ * @return: The value of the function body
+ */
+Val evalSymbol(SymbolIdent* symbol, ArgName arguments[], int k);
+/**
+ * Obtains the value of a user-defined value, evaluating it from its expression the first time it is used after it was defined or invalidated
+ * @return: The value
+ */
+Val evalValue(SymbolIdent* symbol);
+/**
+ * Calls a user-defined function with already evaluated arguments
+ * @return: The value of the function body
+ */
+Val callSymbol(SymbolIdent* symbol, Val values[]);
+/**
+ * Examines wether a string is equal to the identifier of one of the pre-defined functions
+ * @return: 1 if the string is one of the pre-defined ones, 0 otherwise
+ */
+int exists(const char* str);
+/**
+ * Examines whether a call of a built-in that takes the name of a function is well-formed
+ * @return: 1 if the call has the given number of arguments and a name at the given index, 0 otherwise
+ */
+int namesFunction(TreeNode* node, int num, int index);
+/**
+ * Recursively evaluates a parse tree
+ * @return: The values that the tree evaluates to
+ */
+Val eval(TreeNode* curr, ArgName args[], int argNum);
+/**
+ * Evaluates a parse tree of a function whose types have been inferred, without type checks on the nodes known to compute with ints.
+ * The arguments the function assumes are ints must be ints
+ * @return: The values that the tree evaluates to
+ */
+Val evalTyped(TreeNode* curr, ArgName args[], int argNum);
+/**
+ * Creates a new thread
+ * @return: The thread id of the new thread
+ */
+pthread_t doFork(ForkArgs* args);
+/**
+ * Evaluates wether a new thread should be created
+ * @return: 1 if a new thread should be created, 0 otherwise
+ */
+int checkFork(ForkArgs* args);
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * @brief: This is the file containing the hash-consing table for list nodes.
+ * The table is split into stripes, each with its own lock, so that threads building lists concurrently rarely contend.
+ * The interpreter never reclaims list nodes, so the table owns the only allocation of every interned node and entries live for the lifetime of the process.
+ * @file: hashcons.c
+ * @date: 19/10 2026
+ */
+#include "hashcons.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define STRIPE_BITS 6
+#define STRIPES (1 << STRIPE_BITS)
+#define INITIAL_BUCKETS 64
+
+int hashConsing = 0;
+
+/**
+ * Defines an entry in the table.
+ * The list node is stored inline so that interning costs one allocation, same as a plain cons.
+ */
+typedef struct ConsEntry {
+  ValList node; /** The interned node, must be the first member */
+  struct ConsEntry* chain; /** The next entry in the same bucket */
+} ConsEntry;
+
+/**
+ * Defines one independently locked part of the table.
+ */
+typedef struct {
+  pthread_mutex_t lock; /** Guards the buckets of this stripe */
+  ConsEntry** buckets; /** The chains of this stripe */
+  long bucketNum; /** The number of buckets, always a power of two */
+  long size; /** The number of entries in this stripe */
+} ConsStripe;
+
+static ConsStripe stripes[STRIPES];
+static pthread_once_t tableOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Sets up the empty stripes
+ */
+static void initTable() {
+  for (int i = 0; i < STRIPES; i++) {
+    pthread_mutex_init(&stripes[i].lock, NULL);
+    stripes[i].buckets = calloc(INITIAL_BUCKETS, sizeof(ConsEntry*));
+    stripes[i].bucketNum = INITIAL_BUCKETS;
+    stripes[i].size = 0;
+  }
+}
+
+/**
+ * Mixes the identity of a node into a hash
+ * @return: the hash of the value and tail
+ */
+static uint64_t hashNode(Val value, ValList* next) {
+  uint64_t h = (uint64_t) value.value.intval * 0x9e3779b97f4a7c15ULL;
+  h ^= ((uint64_t) (uintptr_t) next + (uint64_t) value.type) * 0xc2b2ae3d27d4eb4fULL;
+  h ^= h >> 31;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 29;
+  return h;
+}
+
+/**
+ * Doubles the number of buckets of a stripe, must be called with the stripe lock held
+ */
+static void growStripe(ConsStripe* stripe) {
+  long newNum = stripe->bucketNum * 2;
+  ConsEntry** newBuckets = calloc(newNum, sizeof(ConsEntry*));
+  if (!newBuckets)
+    return;
+  for (long i = 0; i < stripe->bucketNum; i++) {
+    ConsEntry* entry = stripe->buckets[i];
+    while (entry) {
+      ConsEntry* following = entry->chain;
+      long index = (hashNode(entry->node.value, entry->node.next) >> STRIPE_BITS) & (newNum - 1);
+      entry->chain = newBuckets[index];
+      newBuckets[index] = entry;
+      entry = following;
+    }
+  }
+  free(stripe->buckets);
+  stripe->buckets = newBuckets;
+  stripe->bucketNum = newNum;
+}
+
+/**
+ * Obtains the unique list node with the given value and tail, creating it if no such node exists yet.
+ * @return: a pointer to the interned node
+ */
+ValList* internListNode(Val value, ValList* next) {
+  pthread_once(&tableOnce, initTable);
+  uint64_t hash = hashNode(value, next);
+  ConsStripe* stripe = &stripes[hash & (STRIPES - 1)];
+  pthread_mutex_lock(&stripe->lock);
+  long index = (hash >> STRIPE_BITS) & (stripe->bucketNum - 1);
+  for (ConsEntry* entry = stripe->buckets[index]; entry; entry = entry->chain) {
+    if (entry->node.next == next &&
+	entry->node.value.type == value.type &&
+	entry->node.value.value.intval == value.value.intval) {
+      pthread_mutex_unlock(&stripe->lock);
+      return &entry->node;
+    }
+  }
+  ConsEntry* entry = malloc(sizeof(ConsEntry));
+  entry->node.value = value;
+  entry->node.next = next;
+  entry->node.rest = NULL;
+  entry->chain = stripe->buckets[index];
+  stripe->buckets[index] = entry;
+  if (++stripe->size > stripe->bucketNum * 2)
+    growStripe(stripe);
+  pthread_mutex_unlock(&stripe->lock);
+  return &entry->node;
+}
+
+/**
+ * Obtains the number of interned list nodes
+ * @return: the number of nodes in the table
+ */
+long internedNodeCount() {
+  pthread_once(&tableOnce, initTable);
+  long count = 0;
+  for (int i = 0; i < STRIPES; i++) {
+    pthread_mutex_lock(&stripes[i].lock);
+    count += stripes[i].size;
+    pthread_mutex_unlock(&stripes[i].lock);
+  }
+  return count;
+}
@@ -0,0 +1,26 @@
+/**
+ * @brief: Header for the hash-consing table, which interns list nodes so that structurally equal lists share their memory
+ * @file: hashcons.h
+ * @date: 19/10 2026
+ */
+
+#ifndef HASHCONS_HEADER
+#define HASHCONS_HEADER
+#include "structures.h"
+
+extern int hashConsing; /** Nonzero when list nodes are interned, set before any list is built */
+
+/**
+ * Obtains the unique list node with the given value and tail, creating it if no such node exists yet.
+ * Both the value (if it is a list) and the tail must themselves be interned, which makes pointer equality equivalent to structural equality.
+ * Lists that reach a lazy node are never interned, those are built by createListNode as ordinary nodes.
+ * @return: a pointer to the interned node
+ */
+ValList* internListNode(Val value, ValList* next);
+/**
+ * Obtains the number of interned list nodes
+ * @return: the number of nodes in the table
+ */
+long internedNodeCount();
+
+#endif
@@ -2,6 +2,7 @@
  * Generic map implementation.
  */
 #include "hashmap.h"
+#include "stats.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -228,6 +229,7 @@ int hashmap_rehash(map_t in){
 	hashmap_element* temp = (hashmap_element *)
 		calloc(2 * m->table_size, sizeof(hashmap_element));
 	if(!temp) return MAP_OMEM;
+	statsAdd(StatCounter_REHASHES, 1);
 
 	/* Update the array */
 	curr = m->data;
@@ -0,0 +1,435 @@
+/**
+ * @brief: This is the file containing the implementation of snapshot images.
+ * An image is a header followed by the structures of the symbols laid out as they are in memory, except that every pointer is stored as an offset from the start of the file.
+ * The header points to a table of the offsets of all pointer fields, so that loading only has to add the address of the mapping to each of them.
+ * @file: image.c
+ * @date: 19/10 2026
+ */
+#include "image.h"
+#include "structures.h"
+#include "hashcons.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define IMAGE_MAGIC "ITPIMAGE"
+#define IMAGE_VERSION 3
+#define IMAGE_LAYOUT ((uint32_t) (sizeof(Val) | sizeof(ValList) << 8 | sizeof(TreeNode) << 16 | sizeof(SymbolIdent) << 24))
+
+/**
+ * Defines the start of an image file.
+ */
+typedef struct {
+  char magic[8]; /** Always IMAGE_MAGIC */
+  uint32_t version; /** The IMAGE_VERSION the image was written with */
+  uint32_t layout; /** The IMAGE_LAYOUT the image was written with, images are only loaded by builds with the same structure sizes */
+  uint64_t size; /** The size of the image in bytes */
+  uint64_t symbolNum; /** The number of symbols */
+  uint64_t symbolTable; /** The offset of the array of symbol offsets */
+  uint64_t relocNum; /** The number of pointer fields */
+  uint64_t relocTable; /** The offset of the array of pointer field offsets */
+  uint64_t listNum; /** The number of list nodes */
+  uint64_t listTable; /** The offset of the array of list node offsets */
+} ImageHeader;
+
+/**
+ * Defines a growable array of offsets.
+ */
+typedef struct {
+  uint64_t* data; /** The offsets */
+  uint64_t size; /** The number of offsets */
+  uint64_t capacity; /** The number of offsets there is room for */
+} OffsetArray;
+
+/**
+ * Defines an image that is being written.
+ */
+typedef struct {
+  char* data; /** The bytes of the image */
+  uint64_t size; /** The number of bytes used */
+  uint64_t capacity; /** The number of bytes there is room for */
+  OffsetArray relocs; /** The offsets of the pointer fields */
+  OffsetArray lists; /** The offsets of the list nodes */
+  OffsetArray symbols; /** The offsets of the symbols */
+  uintptr_t* seenKeys; /** The addresses of list nodes already written, so that shared tails are written once */
+  uint64_t* seenOffsets; /** The offsets the nodes in seenKeys were written to */
+  uint64_t seenNum; /** The number of written list nodes */
+  uint64_t seenCapacity; /** The size of the seen table, always a power of two */
+  int failed; /** Nonzero if the symbol being written can not be stored */
+} ImageWriter;
+
+/**
+ * Appends an offset to an array
+ */
+static void pushOffset(OffsetArray* array, uint64_t offset) {
+  if (array->size == array->capacity) {
+    array->capacity = array->capacity ? array->capacity * 2 : 256;
+    array->data = realloc(array->data, sizeof(uint64_t) * array->capacity);
+  }
+  array->data[array->size++] = offset;
+}
+
+/**
+ * Reserves zeroed, pointer aligned room in the image
+ * @return: the offset of the room
+ */
+static uint64_t reserve(ImageWriter* writer, uint64_t size) {
+  uint64_t offset = (writer->size + 7) & ~(uint64_t) 7;
+  if (offset + size > writer->capacity) {
+    while (offset + size > writer->capacity)
+      writer->capacity *= 2;
+    writer->data = realloc(writer->data, writer->capacity);
+  }
+  memset(writer->data + writer->size, 0, offset + size - writer->size);
+  writer->size = offset + size;
+  return offset;
+}
+
+/**
+ * Stores an offset in a pointer field of the image and remembers the field for relocation
+ */
+static void setPointer(ImageWriter* writer, uint64_t field, uint64_t target) {
+  if (!target)
+    return;
+  *(uintptr_t*) (writer->data + field) = (uintptr_t) target;
+  pushOffset(&writer->relocs, field);
+}
+
+/**
+ * Obtains the slot of a list node in the seen table
+ * @return: the index of the node, or of the empty slot where it belongs
+ */
+static uint64_t seenSlot(ImageWriter* writer, ValList* node) {
+  uint64_t index = ((uintptr_t) node >> 4) * 0x9e3779b97f4a7c15ULL & (writer->seenCapacity - 1);
+  while (writer->seenKeys[index] && writer->seenKeys[index] != (uintptr_t) node)
+    index = (index + 1) & (writer->seenCapacity - 1);
+  return index;
+}
+
+/**
+ * Remembers where a list node was written
+ */
+static void markSeen(ImageWriter* writer, ValList* node, uint64_t offset) {
+  if (2 * (writer->seenNum + 1) > writer->seenCapacity) {
+    uintptr_t* oldKeys = writer->seenKeys;
+    uint64_t* oldOffsets = writer->seenOffsets;
+    uint64_t oldCapacity = writer->seenCapacity;
+    writer->seenCapacity *= 2;
+    writer->seenKeys = calloc(writer->seenCapacity, sizeof(uintptr_t));
+    writer->seenOffsets = malloc(sizeof(uint64_t) * writer->seenCapacity);
+    for (uint64_t i = 0; i < oldCapacity; i++) {
+      if (oldKeys[i]) {
+	uint64_t index = seenSlot(writer, (ValList*) oldKeys[i]);
+	writer->seenKeys[index] = oldKeys[i];
+	writer->seenOffsets[index] = oldOffsets[i];
+      }
+    }
+    free(oldKeys);
+    free(oldOffsets);
+  }
+  uint64_t index = seenSlot(writer, node);
+  writer->seenKeys[index] = (uintptr_t) node;
+  writer->seenOffsets[index] = offset;
+  writer->seenNum++;
+}
+
+/**
+ * Writes a string to the image
+ * @return: the offset of the string
+ */
+static uint64_t putString(ImageWriter* writer, const char* str) {
+  if (!str)
+    return 0;
+  uint64_t length = strlen(str) + 1;
+  uint64_t offset = reserve(writer, length);
+  memcpy(writer->data + offset, str, length);
+  return offset;
+}
+
+static uint64_t putList(ImageWriter* writer, ValList* list);
+
+/**
+ * Writes a value into a Val field of the image
+ */
+static void putVal(ImageWriter* writer, uint64_t field, Val v) {
+  ((Val*) (writer->data + field))->type = v.type;
+  switch (getType(v)) {
+  case ValueType_INT:
+    ((Val*) (writer->data + field))->value.intval = getIntVal(v);
+    break;
+  case ValueType_LIST: {
+    uint64_t list = putList(writer, getListVal(v));
+    setPointer(writer, field + offsetof(Val, value), list);
+    break;
+  }
+  case ValueType_CONSTANT:
+  case ValueType_FUNCTION: {
+    uint64_t str = putString(writer, getCharVal(v));
+    setPointer(writer, field + offsetof(Val, value), str);
+    break;
+  }
+  case ValueType_VECTOR: {
+    //The elements follow the vector, a slice is written as a vector of its own
+    Vector* vector = getVectorVal(v);
+    uint64_t offset = reserve(writer, sizeof(Vector) + sizeof(Val) * vector->length);
+    ((Vector*) (writer->data + offset))->length = vector->length;
+    setPointer(writer, offset + offsetof(Vector, elements), offset + sizeof(Vector));
+    for (intptr_t i = 0; i < vector->length; i++)
+      putVal(writer, offset + sizeof(Vector) + sizeof(Val) * i, vector->elements[i]);
+    setPointer(writer, field + offsetof(Val, value), offset);
+    break;
+  }
+  }
+}
+
+/**
+ * Writes a list to the image, forcing lazy nodes. Nodes that were already written are referred to instead of written again
+ * @return: the offset of the first node
+ */
+static uint64_t putList(ImageWriter* writer, ValList* list) {
+  uint64_t first = 0;
+  uint64_t previousField = 0;
+  while (list) {
+    uint64_t index = seenSlot(writer, list);
+    if (writer->seenKeys[index]) {
+      if (previousField)
+	setPointer(writer, previousField, writer->seenOffsets[index]);
+      else
+	first = writer->seenOffsets[index];
+      break;
+    }
+    if (list->rest && list->rest->state != ThunkState_DONE && list->rest->length < 0) {
+      writer->failed = 1;
+      break;
+    }
+    uint64_t offset = reserve(writer, sizeof(ValList));
+    markSeen(writer, list, offset);
+    pushOffset(&writer->lists, offset);
+    putVal(writer, offset + offsetof(ValList, value), list->value);
+    if (previousField)
+      setPointer(writer, previousField, offset);
+    else
+      first = offset;
+    previousField = offset + offsetof(ValList, next);
+    list = getNextNode(list);
+  }
+  return first;
+}
+
+/**
+ * Writes a parse tree to the image
+ * @return: the offset of the root node
+ */
+static uint64_t putTree(ImageWriter* writer, TreeNode* tree) {
+  if (!tree)
+    return 0;
+  uint64_t offset = reserve(writer, sizeof(TreeNode));
+  putVal(writer, offset + offsetof(TreeNode, value), tree->value);
+  uint64_t previousField = offset + offsetof(TreeNode, argList);
+  for (PointerListNode* arg = tree->argList; arg; arg = arg->next) {
+    uint64_t argOffset = reserve(writer, sizeof(PointerListNode));
+    setPointer(writer, previousField, argOffset);
+    setPointer(writer, argOffset + offsetof(PointerListNode, target), putTree(writer, arg->target));
+    previousField = argOffset + offsetof(PointerListNode, next);
+  }
+  return offset;
+}
+
+/**
+ * Writes a symbol to the image, this is called by hashmap_iterate for every symbol
+ * @return: Always returns MAP_OK
+ */
+static int putSymbol(any_t item, any_t data) {
+  ImageWriter* writer = (ImageWriter*) item;
+  SymbolIdent* symbol = (SymbolIdent*) data;
+  uint64_t mark = writer->size;
+  uint64_t relocMark = writer->relocs.size;
+  uint64_t listMark = writer->lists.size;
+  writer->failed = 0;
+  uint64_t offset = reserve(writer, sizeof(SymbolIdent));
+  setPointer(writer, offset + offsetof(SymbolIdent, name), putString(writer, symbol->name));
+  uint64_t previousField = offset + offsetof(SymbolIdent, argNames);
+  for (NameListNode* arg = symbol->argNames; arg; arg = arg->next) {
+    uint64_t argOffset = reserve(writer, sizeof(NameListNode));
+    setPointer(writer, previousField, argOffset);
+    setPointer(writer, argOffset + offsetof(NameListNode, name), putString(writer, arg->name));
+    previousField = argOffset + offsetof(NameListNode, next);
+  }
+  //A value is stored with its expression, so that it can be evaluated again once something it uses is redefined
+  TreeNode unevaluated = {NULL};
+  int evaluated = !symbol->expression || symbol->state == ThunkState_DONE;
+  setPointer(writer, offset + offsetof(SymbolIdent, parseTree), putTree(writer, evaluated ? symbol->parseTree : &unevaluated));
+  if (symbol->expression)
+    setPointer(writer, offset + offsetof(SymbolIdent, expression), putTree(writer, symbol->expression));
+  ((SymbolIdent*) (writer->data + offset))->state = evaluated ? ThunkState_DONE : ThunkState_PENDING;
+  if (writer->failed) {
+    printf("Can not store %s in the image, it is bound to an unbounded list\n", symbol->name);
+    //Drop everything written for the symbol, including the nodes it marked as seen
+    for (uint64_t i = 0; i < writer->seenCapacity; i++)
+      if (writer->seenKeys[i] && writer->seenOffsets[i] >= mark)
+	writer->seenKeys[i] = 0;
+    writer->size = mark;
+    writer->relocs.size = relocMark;
+    writer->lists.size = listMark;
+    return MAP_OK;
+  }
+  pushOffset(&writer->symbols, offset);
+  return MAP_OK;
+}
+
+/**
+ * Appends an array of offsets to the image
+ * @return: the offset of the array
+ */
+static uint64_t putOffsets(ImageWriter* writer, OffsetArray* array) {
+  uint64_t offset = reserve(writer, sizeof(uint64_t) * array->size);
+  if (array->size)
+    memcpy(writer->data + offset, array->data, sizeof(uint64_t) * array->size);
+  return offset;
+}
+
+/**
+ * Writes all symbols of a symbol map to an image file.
+ * @return: MAP_OK if the image was written, MAP_MISSING if the file could not be written
+ */
+int writeImage(const char* path, map_t symbols) {
+  ImageWriter writer;
+  memset(&writer, 0, sizeof(ImageWriter));
+  writer.capacity = 1 << 16;
+  writer.data = malloc(writer.capacity);
+  writer.seenCapacity = 1024;
+  writer.seenKeys = calloc(writer.seenCapacity, sizeof(uintptr_t));
+  writer.seenOffsets = malloc(sizeof(uint64_t) * writer.seenCapacity);
+  reserve(&writer, sizeof(ImageHeader));
+  hashmap_iterate(symbols, putSymbol, &writer);
+  uint64_t symbolTable = putOffsets(&writer, &writer.symbols);
+  uint64_t relocTable = putOffsets(&writer, &writer.relocs);
+  uint64_t listTable = putOffsets(&writer, &writer.lists);
+  ImageHeader* header = (ImageHeader*) writer.data;
+  memcpy(header->magic, IMAGE_MAGIC, 8);
+  header->version = IMAGE_VERSION;
+  header->layout = IMAGE_LAYOUT;
+  header->size = writer.size;
+  header->symbolNum = writer.symbols.size;
+  header->symbolTable = symbolTable;
+  header->relocNum = writer.relocs.size;
+  header->relocTable = relocTable;
+  header->listNum = writer.lists.size;
+  header->listTable = listTable;
+  int status = MAP_OK;
+  FILE* out = fopen(path, "wb");
+  if (!out || fwrite(writer.data, 1, writer.size, out) != writer.size) {
+    printf("Failed to write image %s\n", path);
+    status = MAP_MISSING;
+  }
+  if (out)
+    fclose(out);
+  free(writer.data);
+  free(writer.relocs.data);
+  free(writer.lists.data);
+  free(writer.symbols.data);
+  free(writer.seenKeys);
+  free(writer.seenOffsets);
+  return status;
+}
+
+/**
+ * Marks list nodes loaded from an image as not hash-consed, there is nothing to force
+ */
+static ListThunk imageThunk = {NULL, -1, {{0}, 0}, 0, NULL, NULL, ThunkState_DONE};
+
+/**
+ * Examines whether a structure lies within an image, at an aligned offset past the header
+ * @return: 1 if it does, 0 otherwise
+ */
+static int fitsImage(const ImageHeader* header, uint64_t offset, uint64_t size) {
+  return offset >= sizeof(ImageHeader) && !(offset & 7) && offset <= header->size && size <= header->size - offset;
+}
+
+/**
+ * Examines whether an array of offsets lies within an image, and every offset in it points to a structure of the given size within the image
+ * @return: 1 if it does, 0 otherwise
+ */
+static int checkTable(const char* base, const ImageHeader* header, uint64_t table, uint64_t num, uint64_t size) {
+  if (num > header->size / sizeof(uint64_t) || !fitsImage(header, table, num * sizeof(uint64_t)))
+    return 0;
+  const uint64_t* offsets = (const uint64_t*) (base + table);
+  for (uint64_t i = 0; i < num; i++) {
+    if (!fitsImage(header, offsets[i], size))
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * Examines whether the tables of an image, and the pointers its relocations point to, lie within the image, so that a corrupt or truncated image is never written through
+ * @return: 1 if they do, 0 otherwise
+ */
+static int checkImage(const char* base, const ImageHeader* header) {
+  if (!checkTable(base, header, header->relocTable, header->relocNum, sizeof(uintptr_t)) ||
+      !checkTable(base, header, header->listTable, header->listNum, sizeof(ValList)) ||
+      !checkTable(base, header, header->symbolTable, header->symbolNum, sizeof(SymbolIdent)))
+    return 0;
+  const uint64_t* relocs = (const uint64_t*) (base + header->relocTable);
+  for (uint64_t i = 0; i < header->relocNum; i++) {
+    if (*(const uintptr_t*) (base + relocs[i]) >= header->size)
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * Maps an image file into memory and adds all its symbols to a symbol map.
+ * @return: MAP_OK if the image was loaded, MAP_MISSING if the file could not be read or is not a compatible image
+ */
+int loadImage(const char* path, map_t symbols) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("Failed to open image %s\n", path);
+    return MAP_MISSING;
+  }
+  struct stat info;
+  if (fstat(fd, &info) || info.st_size < (off_t) sizeof(ImageHeader)) {
+    printf("%s is not an image\n", path);
+    close(fd);
+    return MAP_MISSING;
+  }
+  char* base = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    printf("Failed to map image %s\n", path);
+    return MAP_MISSING;
+  }
+  ImageHeader* header = (ImageHeader*) base;
+  if (memcmp(header->magic, IMAGE_MAGIC, 8) || header->version != IMAGE_VERSION ||
+      header->layout != IMAGE_LAYOUT || header->size != (uint64_t) info.st_size) {
+    printf("%s is not an image of this version of the interpreter\n", path);
+    munmap(base, info.st_size);
+    return MAP_MISSING;
+  }
+  if (!checkImage(base, header)) {
+    printf("%s is corrupt\n", path);
+    munmap(base, info.st_size);
+    return MAP_MISSING;
+  }
+  uint64_t* relocs = (uint64_t*) (base + header->relocTable);
+  for (uint64_t i = 0; i < header->relocNum; i++)
+    *(uintptr_t*) (base + relocs[i]) += (uintptr_t) base;
+  if (hashConsing) {
+    uint64_t* lists = (uint64_t*) (base + header->listTable);
+    for (uint64_t i = 0; i < header->listNum; i++)
+      ((ValList*) (base + lists[i]))->rest = &imageThunk;
+  }
+  uint64_t* table = (uint64_t*) (base + header->symbolTable);
+  for (uint64_t i = 0; i < header->symbolNum; i++) {
+    SymbolIdent* symbol = (SymbolIdent*) (base + table[i]);
+    hashmap_put(symbols, symbol->name, symbol);
+  }
+  return MAP_OK;
+}
@@ -0,0 +1,24 @@
+/**
+ * @brief: Header for snapshot images, which store the user-defined symbols so that later runs can start without parsing them again
+ * @file: image.h
+ * @date: 19/10 2026
+ */
+
+#ifndef IMAGE_HEADER
+#define IMAGE_HEADER
+#include "hashmap.h"
+
+/**
+ * Writes all symbols of a symbol map to an image file.
+ * Constants are stored with their evaluated values. Constants bound to lists without a known end can not be stored and are skipped.
+ * @return: MAP_OK if the image was written, MAP_MISSING if the file could not be written
+ */
+int writeImage(const char* path, map_t symbols);
+/**
+ * Maps an image file into memory and adds all its symbols to a symbol map.
+ * The symbols are used in place from the mapping, loading only adjusts the pointers within it.
+ * @return: MAP_OK if the image was loaded, MAP_MISSING if the file could not be read or is not a compatible image
+ */
+int loadImage(const char* path, map_t symbols);
+
+#endif
@@ -0,0 +1,367 @@
+/**
+ * @brief: This is the file containing the JIT compiler.
+ * Every function is translated node by node from templates. The value of a node ends up in rax, the operands of an operation wait on the stack, and the arguments of the function being compiled stay in the callee-saved registers rbx, r12, r13, r14 and r15 for the whole call. Calls between compiled functions are native calls, and calls of the function itself in tail position jump back to the start of its body.
+ * A function is compiled together with every function it calls that is not compiled yet, into one executable buffer that is never freed
+ * @file: jit.c
+ * @date: 19/10 2026
+ */
+#define _DEFAULT_SOURCE //for MAP_ANONYMOUS
+#include "jit.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int jitEnabled = 0;
+
+typedef intptr_t (*NativeFunction)(intptr_t, intptr_t, intptr_t, intptr_t, intptr_t);
+
+/**
+ * Defines a function being compiled.
+ */
+typedef struct {
+  SymbolIdent* symbol; /** The function */
+  size_t entry; /** The offset of its first instruction */
+  size_t body; /** The offset of its body, after the arguments are moved to their registers */
+} JitFunction;
+
+/**
+ * Defines a call whose target is only known once every function is placed.
+ */
+typedef struct {
+  size_t position; /** The offset of the 32 bit displacement to fill in */
+  int target; /** The index of the function called */
+} JitFixup;
+
+/**
+ * Defines the code and the functions of one compilation.
+ */
+typedef struct {
+  unsigned char* code; /** The instructions */
+  size_t size; /** The number of bytes used in code */
+  size_t capacity; /** The size of code */
+  JitFunction* functions; /** The functions compiled together */
+  int functionNum; /** The number of functions */
+  int functionCapacity; /** The size of functions */
+  JitFixup* fixups; /** The calls to patch */
+  int fixupNum; /** The number of fixups */
+  int fixupCapacity; /** The size of fixups */
+} JitBuffer;
+
+static pthread_mutex_t jitLock = PTHREAD_MUTEX_INITIALIZER;
+
+static const unsigned char movFromArg[JIT_MAX_ARGS][3] = {{0x48,0x89,0xD8}, {0x4C,0x89,0xE0}, {0x4C,0x89,0xE8}, {0x4C,0x89,0xF0}, {0x4C,0x89,0xF8}}; /** mov rax, rbx/r12/r13/r14/r15 */
+static const unsigned char movToArg[JIT_MAX_ARGS][3] = {{0x48,0x89,0xFB}, {0x49,0x89,0xF4}, {0x49,0x89,0xD5}, {0x49,0x89,0xCE}, {0x4D,0x89,0xC7}}; /** mov rbx/r12/r13/r14/r15, rdi/rsi/rdx/rcx/r8 */
+static const unsigned char popArg[JIT_MAX_ARGS][2] = {{0x5B}, {0x41,0x5C}, {0x41,0x5D}, {0x41,0x5E}, {0x41,0x5F}}; /** pop rbx/r12/r13/r14/r15 */
+static const unsigned char popParameter[JIT_MAX_ARGS][2] = {{0x5F}, {0x5E}, {0x5A}, {0x59}, {0x41,0x58}}; /** pop rdi/rsi/rdx/rcx/r8 */
+
+/**
+ * Appends instructions to the code
+ */
+static void emit(JitBuffer* buffer, const void* bytes, size_t length) {
+  if (buffer->size + length > buffer->capacity) {
+    buffer->capacity = 2 * buffer->capacity + length + 256;
+    buffer->code = realloc(buffer->code, buffer->capacity);
+  }
+  memcpy(buffer->code + buffer->size, bytes, length);
+  buffer->size += length;
+}
+
+/**
+ * Appends a single byte to the code
+ */
+static void emitByte(JitBuffer* buffer, unsigned char byte) {
+  emit(buffer, &byte, 1);
+}
+
+/**
+ * Appends a 32 bit displacement, to be filled in later
+ * @return: the offset of the displacement
+ */
+static size_t emitDisplacement(JitBuffer* buffer) {
+  int32_t zero = 0;
+  emit(buffer, &zero, 4);
+  return buffer->size - 4;
+}
+
+/**
+ * Fills in a displacement so that it leads to an offset of the code
+ */
+static void patch(JitBuffer* buffer, size_t position, size_t target) {
+  int32_t displacement = (int32_t) (target - (position + 4));
+  memcpy(buffer->code + position, &displacement, 4);
+}
+
+/**
+ * Counts the names in a list of argument names
+ */
+static int countNames(NameListNode* names) {
+  int num = 0;
+  for (; names; names = names->next)
+    num++;
+  return num;
+}
+
+/**
+ * Counts the children of a node
+ */
+static int countChildren(TreeNode* node) {
+  int num = 0;
+  for (PointerListNode* child = node->argList; child; child = child->next)
+    num++;
+  return num;
+}
+
+/**
+ * Finds which argument a name is
+ * @return: the index of the argument, or -1 if the name is not an argument
+ */
+static int argumentIndex(NameListNode* names, const char* name) {
+  for (int i = 0; names; names = names->next, i++) {
+    if (!strcmp(names->name, name))
+      return i;
+  }
+  return -1;
+}
+
+/**
+ * Finds the function being compiled that a symbol is
+ * @return: the index of the function, or -1 if it is not being compiled
+ */
+static int functionIndex(JitBuffer* buffer, SymbolIdent* symbol) {
+  for (int i = 0; i < buffer->functionNum; i++) {
+    if (buffer->functions[i].symbol == symbol)
+      return i;
+  }
+  return -1;
+}
+
+/**
+ * Examines whether a name is one of the int operations that are compiled
+ */
+static int isOperation(const char* name) {
+  return !strcmp(name, "plus") || !strcmp(name, "minus") || !strcmp(name, "mult") || !strcmp(name, "divide") ||
+    !strcmp(name, "equals") || !strcmp(name, "lesser") || !strcmp(name, "greater") || !strcmp(name, "ite");
+}
+
+static int addFunction(JitBuffer* buffer, SymbolIdent* symbol);
+
+/**
+ * Examines whether a tree can be compiled, adding the functions it calls to the compilation
+ * @return: 1 if it can be compiled, 0 otherwise
+ */
+static int checkTree(JitBuffer* buffer, TreeNode* node, NameListNode* names) {
+  SymbolIdent* symbol;
+  switch (getType(node->value)) {
+  case ValueType_INT:
+    return 1;
+  case ValueType_LIST:
+  case ValueType_VECTOR:
+    return 0;
+  case ValueType_CONSTANT:
+    if (argumentIndex(names, getCharVal(node->value)) >= 0)
+      return 1;
+    //A value that has been evaluated is compiled as a constant, redefining anything it uses drops the compiled code
+    return hashmap_get(context->symbols, getCharVal(node->value), (any_t*) &symbol) == MAP_OK &&
+      !symbol->argNames && (!symbol->expression || symbol->state == ThunkState_DONE) &&
+      getType(symbol->parseTree->value) == ValueType_INT && !symbol->parseTree->argList;
+  case ValueType_FUNCTION:
+    if (!isOperation(getCharVal(node->value))) {
+      if (exists(getCharVal(node->value)) ||
+	  hashmap_get(context->symbols, getCharVal(node->value), (any_t*) &symbol) != MAP_OK ||
+	  !symbol->argNames || countNames(symbol->argNames) != countChildren(node) ||
+	  !addFunction(buffer, symbol))
+	return 0;
+    }
+    for (PointerListNode* child = node->argList; child; child = child->next) {
+      if (!checkTree(buffer, child->target, names))
+	return 0;
+    }
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Adds a function to the compilation, unless it is compiled already, along with the functions it calls
+ * @return: 1 if the function can be compiled, 0 otherwise
+ */
+static int addFunction(JitBuffer* buffer, SymbolIdent* symbol) {
+  if (symbol->native || functionIndex(buffer, symbol) >= 0)
+    return 1;
+  if (symbol->calls < 0 || countNames(symbol->argNames) > JIT_MAX_ARGS)
+    return 0;
+  if (buffer->functionNum == buffer->functionCapacity) {
+    buffer->functionCapacity = 2 * buffer->functionCapacity + 4;
+    buffer->functions = realloc(buffer->functions, sizeof(JitFunction) * buffer->functionCapacity);
+  }
+  buffer->functions[buffer->functionNum++].symbol = symbol;
+  return checkTree(buffer, symbol->parseTree, symbol->argNames);
+}
+
+/**
+ * Emits the code of a tree, leaving its value in rax
+ * @param: The compilation, the index of the function the tree belongs to, the tree, whether the tree is in tail position, and the number of words pushed since the stack was aligned
+ */
+static void compileTree(JitBuffer* buffer, int function, TreeNode* node, int tail, int depth) {
+  NameListNode* names = buffer->functions[function].symbol->argNames;
+  char* name = getCharVal(node->value);
+  SymbolIdent* symbol;
+  if (getType(node->value) == ValueType_INT || getType(node->value) == ValueType_CONSTANT) {
+    int index = getType(node->value) == ValueType_CONSTANT ? argumentIndex(names, name) : -1;
+    if (index >= 0) {
+      emit(buffer, movFromArg[index], 3);
+      return;
+    }
+    intptr_t value = node->value.value.intval;
+    if (getType(node->value) == ValueType_CONSTANT) {
+      hashmap_get(context->symbols, name, (any_t*) &symbol);
+      value = getIntVal(symbol->parseTree->value);
+    }
+    emit(buffer, "\x48\xB8", 2); //mov rax, value
+    emit(buffer, &value, 8);
+    return;
+  }
+  if (!strcmp(name, "ite")) {
+    compileTree(buffer, function, getArgNode(node, 0), 0, depth);
+    emit(buffer, "\x48\x85\xC0\x0F\x84", 5); //test rax, rax; jz else
+    size_t toElse = emitDisplacement(buffer);
+    compileTree(buffer, function, getArgNode(node, 1), tail, depth);
+    emitByte(buffer, 0xE9); //jmp end
+    size_t toEnd = emitDisplacement(buffer);
+    patch(buffer, toElse, buffer->size);
+    compileTree(buffer, function, getArgNode(node, 2), tail, depth);
+    patch(buffer, toEnd, buffer->size);
+    return;
+  }
+  if (isOperation(name)) {
+    compileTree(buffer, function, getArgNode(node, 1), 0, depth);
+    emitByte(buffer, 0x50); //push rax
+    compileTree(buffer, function, getArgNode(node, 0), 0, depth + 1);
+    emitByte(buffer, 0x59); //pop rcx
+    if (!strcmp(name, "plus"))
+      emit(buffer, "\x48\x01\xC8", 3); //add rax, rcx
+    else if (!strcmp(name, "minus"))
+      emit(buffer, "\x48\x29\xC8", 3); //sub rax, rcx
+    else if (!strcmp(name, "mult"))
+      emit(buffer, "\x48\x0F\xAF\xC1", 4); //imul rax, rcx
+    else if (!strcmp(name, "divide"))
+      emit(buffer, "\x48\x99\x48\xF7\xF9", 5); //cqo; idiv rcx
+    else {
+      emit(buffer, "\x48\x39\xC8\x0F", 4); //cmp rax, rcx; setcc al
+      emitByte(buffer, !strcmp(name, "equals") ? 0x94 : (!strcmp(name, "lesser") ? 0x9C : 0x9F));
+      emit(buffer, "\xC0\x48\x0F\xB6\xC0", 5); //movzx rax, al
+    }
+    return;
+  }
+  //A call, the arguments are pushed in order and popped into the registers they are passed in
+  hashmap_get(context->symbols, name, (any_t*) &symbol);
+  int num = 0;
+  for (PointerListNode* child = node->argList; child; child = child->next, num++) {
+    compileTree(buffer, function, child->target, 0, depth + num);
+    emitByte(buffer, 0x50); //push rax
+  }
+  if (tail && symbol == buffer->functions[function].symbol) {
+    for (int i = num - 1; i >= 0; i--)
+      emit(buffer, popArg[i], i ? 2 : 1);
+    emitByte(buffer, 0xE9); //jmp body
+    patch(buffer, emitDisplacement(buffer), buffer->functions[function].body);
+    return;
+  }
+  for (int i = num - 1; i >= 0; i--)
+    emit(buffer, popParameter[i], i == 4 ? 2 : 1);
+  if (depth % 2)
+    emit(buffer, "\x48\x83\xEC\x08", 4); //sub rsp, 8
+  if (symbol->native) {
+    emit(buffer, "\x48\xB8", 2); //mov rax, native; call rax
+    emit(buffer, &symbol->native, 8);
+    emit(buffer, "\xFF\xD0", 2);
+  }
+  else {
+    emitByte(buffer, 0xE8); //call entry
+    if (buffer->fixupNum == buffer->fixupCapacity) {
+      buffer->fixupCapacity = 2 * buffer->fixupCapacity + 16;
+      buffer->fixups = realloc(buffer->fixups, sizeof(JitFixup) * buffer->fixupCapacity);
+    }
+    buffer->fixups[buffer->fixupNum].position = emitDisplacement(buffer);
+    buffer->fixups[buffer->fixupNum++].target = functionIndex(buffer, symbol);
+  }
+  if (depth % 2)
+    emit(buffer, "\x48\x83\xC4\x08", 4); //add rsp, 8
+}
+
+/**
+ * Emits a whole function. The five callee-saved registers are pushed, which leaves the stack aligned
+ */
+static void compileFunction(JitBuffer* buffer, int function) {
+  JitFunction* compiled = &buffer->functions[function];
+  compiled->entry = buffer->size;
+  emit(buffer, "\x53\x41\x54\x41\x55\x41\x56\x41\x57", 9); //push rbx, r12, r13, r14, r15
+  int num = countNames(compiled->symbol->argNames);
+  for (int i = 0; i < num; i++)
+    emit(buffer, movToArg[i], 3);
+  compiled->body = buffer->size;
+  compileTree(buffer, function, compiled->symbol->parseTree, 1, 0);
+  emit(buffer, "\x41\x5F\x41\x5E\x41\x5D\x41\x5C\x5B\xC3", 10); //pop r15, r14, r13, r12, rbx; ret
+}
+
+/**
+ * Compiles a function together with the functions it calls
+ */
+int jitCompile(SymbolIdent* symbol) {
+#if defined(__x86_64__)
+  pthread_mutex_lock(&jitLock);
+  if (symbol->native) {
+    pthread_mutex_unlock(&jitLock);
+    return 1;
+  }
+  JitBuffer buffer;
+  memset(&buffer, 0, sizeof(JitBuffer));
+  int compiled = addFunction(&buffer, symbol);
+  if (compiled) {
+    for (int i = 0; i < buffer.functionNum; i++)
+      compileFunction(&buffer, i);
+    for (int i = 0; i < buffer.fixupNum; i++)
+      patch(&buffer, buffer.fixups[i].position, buffer.functions[buffer.fixups[i].target].entry);
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = (buffer.size + page - 1) / page * page;
+    unsigned char* code = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED)
+      compiled = 0;
+    else {
+      memcpy(code, buffer.code, buffer.size);
+      mprotect(code, size, PROT_READ | PROT_EXEC);
+      __sync_synchronize();
+      for (int i = 0; i < buffer.functionNum; i++)
+	buffer.functions[i].symbol->native = code + buffer.functions[i].entry;
+    }
+  }
+  if (!compiled)
+    symbol->calls = -1;
+  free(buffer.code);
+  free(buffer.functions);
+  free(buffer.fixups);
+  pthread_mutex_unlock(&jitLock);
+  return compiled;
+#else
+  symbol->calls = -1;
+  return 0;
+#endif
+}
+
+/**
+ * Calls the compiled code of a function, if all arguments are ints
+ */
+int jitCall(SymbolIdent* symbol, ArgName arguments[], int k, Val* result) {
+  intptr_t values[JIT_MAX_ARGS] = {0};
+  for (int i = 0; i < k; i++) {
+    if (arguments[i].thunk || getType(arguments[i].value) != ValueType_INT)
+      return 0;
+    values[i] = getIntVal(arguments[i].value);
+  }
+  NativeFunction native = (NativeFunction) symbol->native;
+  *result = createVal(ValueType_INT, native(values[0], values[1], values[2], values[3], values[4]));
+  return 1;
+}
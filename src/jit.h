@@ -0,0 +1,29 @@
+/**
+ * @brief: Header for the JIT compiler, which compiles user-defined functions that only compute with ints to native x86-64 code
+ * @file: jit.h
+ * @date: 19/10 2026
+ */
+
+#ifndef JIT_HEADER
+#define JIT_HEADER
+#include "eval.h"
+
+#define JIT_THRESHOLD 100 /** The number of calls after which a function is compiled */
+#define JIT_MAX_ARGS 5 /** The most arguments a compiled function can take */
+
+extern int jitEnabled; /** Nonzero if functions are compiled once called often enough, set before any evaluation */
+
+/**
+ * Compiles a function together with the functions it calls.
+ * A function can be compiled if it takes at most JIT_MAX_ARGS arguments and its body only uses int constants, its arguments, int values that have been evaluated, + - * div = < >, if-then-else, and calls of functions that can be compiled. Otherwise calls is set to -1 so that it is not tried again
+ * @return: 1 if the function was compiled, 0 otherwise
+ */
+int jitCompile(SymbolIdent* symbol);
+/**
+ * Calls the compiled code of a function, if all arguments are ints that have been evaluated
+ * @param: The function, its bound arguments and their number, and where to store the value
+ * @return: 1 if the value was stored, 0 if an argument is not an int or is suspended and the function must be evaluated instead
+ */
+int jitCall(SymbolIdent* symbol, ArgName arguments[], int k, Val* result);
+
+#endif
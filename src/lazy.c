@@ -0,0 +1,166 @@
+/**
+ * @brief: This is the file containing the thunks and the strictness analysis of call-by-need evaluation.
+ * The strict arguments of a group of functions that call each other are found together, starting from every argument being strict and removing the ones some evaluation does not use until nothing changes. Strict arguments are evaluated before the call as usual, possibly on threads of their own, so only the arguments that may not be needed pay for a thunk
+ * @file: lazy.c
+ * @date: 19/10 2026
+ */
+#include "lazy.h"
+#include "speculate.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_STRICT_ARGS 32 /** The number of arguments that fit in strictArgs, the ones after are always strict */
+
+int lazy = 0;
+
+/**
+ * Defines the functions analysed together.
+ */
+typedef struct {
+  SymbolIdent** symbols; /** The functions */
+  int num; /** The number of functions */
+  int capacity; /** The size of symbols */
+} StrictnessGroup;
+
+static pthread_mutex_t strictnessLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Obtains the value of a suspended argument, evaluating it the first time
+ */
+Val forceThunk(Thunk* thunk) {
+  while (thunk->state != ThunkState_DONE) {
+    if (__sync_bool_compare_and_swap(&thunk->state, ThunkState_PENDING, ThunkState_FORCING)) {
+      Val value = eval(thunk->target, thunk->args, thunk->num);
+      if (speculationCancelled()) {
+	//The value is thrown away, whoever needs it forces the thunk again
+	thunk->state = ThunkState_PENDING;
+	return value;
+      }
+      thunk->value = value;
+      __sync_synchronize();
+      thunk->state = ThunkState_DONE;
+    }
+    else
+      sched_yield();
+  }
+  return thunk->value;
+}
+
+/**
+ * Finds which argument a name is
+ * @return: the index of the argument, or -1 if the name is not an argument
+ */
+static int argumentIndex(NameListNode* names, const char* name) {
+  for (int i = 0; names; names = names->next, i++) {
+    if (!strcmp(names->name, name))
+      return i;
+  }
+  return -1;
+}
+
+/**
+ * Looks up the function a node calls
+ * @return: the function, or NULL if it is not a user-defined function with arguments
+ */
+static SymbolIdent* callee(TreeNode* node) {
+  SymbolIdent* symbol;
+  if (exists(getCharVal(node->value)) || hashmap_get(context->symbols, getCharVal(node->value), (any_t*) &symbol) != MAP_OK || !symbol->argNames)
+    return NULL;
+  return symbol;
+}
+
+/**
+ * Adds a function to the group, along with the functions it calls that have not been analysed
+ */
+static void collect(StrictnessGroup* group, SymbolIdent* symbol);
+
+/**
+ * Adds the functions a tree calls to the group
+ */
+static void collectTree(StrictnessGroup* group, TreeNode* node) {
+  if (getType(node->value) != ValueType_FUNCTION)
+    return;
+  SymbolIdent* symbol = callee(node);
+  if (symbol)
+    collect(group, symbol);
+  for (PointerListNode* child = node->argList; child; child = child->next)
+    collectTree(group, child->target);
+}
+
+static void collect(StrictnessGroup* group, SymbolIdent* symbol) {
+  if (symbol->strictness)
+    return;
+  for (int i = 0; i < group->num; i++) {
+    if (group->symbols[i] == symbol)
+      return;
+  }
+  if (group->num == group->capacity) {
+    group->capacity = 2 * group->capacity + 4;
+    group->symbols = realloc(group->symbols, sizeof(SymbolIdent*) * group->capacity);
+  }
+  group->symbols[group->num++] = symbol;
+  symbol->strictArgs = ~0u;
+  collectTree(group, symbol->parseTree);
+}
+
+/**
+ * Finds the arguments every evaluation of a tree evaluates
+ * @param: The tree, and the function it belongs to
+ * @return: the arguments as a bit mask
+ */
+static unsigned strictIn(TreeNode* node, SymbolIdent* symbol) {
+  switch (getType(node->value)) {
+  case ValueType_CONSTANT: {
+    int index = argumentIndex(symbol->argNames, getCharVal(node->value));
+    return index >= 0 && index < MAX_STRICT_ARGS ? 1u << index : 0;
+  }
+  case ValueType_FUNCTION: {
+    char* name = getCharVal(node->value);
+    PointerListNode* children = node->argList;
+    if (!strcmp(name, "ite"))
+      return strictIn(children->target, symbol) |
+	(strictIn(children->next->target, symbol) & strictIn(children->next->next->target, symbol));
+    if (!strcmp(name, "iterate"))
+      return namesFunction(node, 2, 0) ? strictIn(children->next->target, symbol) : 0;
+    if (!strcmp(name, "sort"))
+      return namesFunction(node, 1, -1) || namesFunction(node, 2, 1) ? strictIn(children->target, symbol) : 0;
+    SymbolIdent* called = callee(node);
+    unsigned strict = 0;
+    int i = 0;
+    for (PointerListNode* child = children; child; child = child->next, i++) {
+      if (!called || i >= MAX_STRICT_ARGS || (called->strictArgs >> i & 1))
+	strict |= strictIn(child->target, symbol);
+    }
+    return strict;
+  }
+  default:
+    return 0;
+  }
+}
+
+/**
+ * Finds the strict arguments of a function and of every function it calls that has not been analysed yet
+ */
+void analyseStrictness(SymbolIdent* symbol) {
+  pthread_mutex_lock(&strictnessLock);
+  StrictnessGroup group = {NULL, 0, 0};
+  collect(&group, symbol);
+  int changed = 1;
+  while (changed) {
+    changed = 0;
+    for (int i = 0; i < group.num; i++) {
+      unsigned strict = group.symbols[i]->strictArgs & strictIn(group.symbols[i]->parseTree, group.symbols[i]);
+      if (strict != group.symbols[i]->strictArgs) {
+	group.symbols[i]->strictArgs = strict;
+	changed = 1;
+      }
+    }
+  }
+  __sync_synchronize();
+  for (int i = 0; i < group.num; i++)
+    group.symbols[i]->strictness = 1;
+  free(group.symbols);
+  pthread_mutex_unlock(&strictnessLock);
+}
@@ -0,0 +1,37 @@
+/**
+ * @brief: Header for call-by-need evaluation, where the arguments of user-defined functions that are not always used are evaluated when they are first used
+ * @file: lazy.h
+ * @date: 19/10 2026
+ */
+
+#ifndef LAZY_HEADER
+#define LAZY_HEADER
+#include "eval.h"
+
+extern int lazy; /** Nonzero if arguments that are not strict are suspended, set before any evaluation */
+
+/**
+ * Defines a suspended argument.
+ * A thunk lives on the stack of the call that binds it, and is shared by the calls it is passed on to unevaluated, which all return before the call that binds it
+ */
+typedef struct Thunk {
+  TreeNode* target; /** The tree of the argument */
+  ArgName* args; /** The local symbol bindings of the tree */
+  int num; /** The number of bindings */
+  Val value; /** The value, once the state is ThunkState_DONE */
+  volatile int state; /** The ThunkState of the thunk */
+} Thunk;
+
+/**
+ * Obtains the value of a suspended argument, evaluating it the first time. Threads that demand it while it is evaluated wait for the value, a value computed for a cancelled speculation is not kept
+ * @return: the value of the argument
+ */
+Val forceThunk(Thunk* thunk);
+/**
+ * Finds the strict arguments of a function and of every function it calls that has not been analysed yet.
+ * An argument is strict if every evaluation of the body evaluates it: it is used outside of an if-then-else, in the condition, in both branches, or as a strict argument of a function
+ * @param: The function, defined in the interpreter of the current thread
+ */
+void analyseStrictness(SymbolIdent* symbol);
+
+#endif
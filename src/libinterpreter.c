@@ -0,0 +1,637 @@
+/**
+ * @brief: This is the file containing the interpreter library, which binds parsers and the evaluator to interpreter instances
+ * @file: libinterpreter.c
+ * @date: 19/10 2026
+ */
+#undef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700 //for open_memstream
+#include "libinterpreter.h"
+#include "cache.h"
+#include "compiler.h"
+#include "eval.h"
+#include "output.h"
+#include "parser.h"
+#include "stats.h"
+#include "trace.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Defines a declaration of a batch, and for values and expressions the task of evaluating it.
+ */
+typedef struct BatchEntry {
+  SymbolIdent* declaration; /** The declaration as parsed */
+  SymbolIdent* constant; /** For a value, the symbol whose value the task fills in */
+  int task; /** Nonzero if the declaration must be evaluated */
+  int redefinition; /** Nonzero if the declaration defines a built-in function */
+  char* text; /** What the declaration prints */
+  size_t length; /** The length of text */
+  int waiting; /** The number of unfinished tasks this task depends on */
+  struct BatchEntry** dependents; /** The tasks that depend on this one */
+  int dependentNum; /** The number of dependents */
+  int dependentCapacity; /** The size of dependents */
+  int done; /** Nonzero once text is complete */
+  struct BatchEntry* next; /** The next task ready to run */
+} BatchEntry;
+
+/**
+ * Defines the state of a batch shared by its workers.
+ */
+typedef struct Batch {
+  Interpreter* interpreter; /** The interpreter the batch runs in */
+  BatchEntry* ready; /** The tasks whose dependencies are done */
+  int unstarted; /** The number of tasks not yet taken by a worker */
+  pthread_mutex_t lock; /** Guards the fields of the batch and of its entries */
+  pthread_cond_t readyCond; /** Signalled when a task becomes ready */
+  pthread_cond_t doneCond; /** Signalled when a task is done */
+} Batch;
+
+/**
+ * Defines a bounded queue of parsed declarations between the parsing thread and the evaluating thread of a pipeline.
+ */
+typedef struct Pipeline {
+  Parser* parser; /** The parser the parsing thread reads with */
+  SymbolIdent** queue; /** The ring of parsed declarations, PARSE_QUIT ends the input */
+  int capacity; /** The size of queue */
+  int head; /** The index of the next declaration to evaluate */
+  int num; /** The number of declarations in queue */
+  pthread_mutex_t lock; /** Guards head and num */
+  pthread_cond_t notEmpty; /** Signalled when a declaration is added */
+  pthread_cond_t notFull; /** Signalled when a declaration is removed */
+} Pipeline;
+
+/**
+ * Creates an interpreter with no symbols defined
+ */
+Interpreter* interpreterNew() {
+  Interpreter* interpreter = malloc(sizeof(Interpreter));
+  interpreter->symbols = hashmap_new();
+  interpreter->maxThreads = 10;
+  interpreter->numThreads = 0;
+  return interpreter;
+}
+
+/**
+ * Sets the maximum number of threads an interpreter forks to evaluate arguments in parallel
+ */
+void interpreterSetThreads(Interpreter* interpreter, int maxThreads) {
+  interpreter->maxThreads = maxThreads;
+}
+
+/**
+ * Obtains the symbols of an interpreter
+ */
+map_t interpreterSymbols(Interpreter* interpreter) {
+  return interpreter->symbols;
+}
+
+/**
+ * Defines the state of an invalidation.
+ */
+typedef struct {
+  map_t changed; /** The names whose meaning changed */
+  SymbolIdent** symbols; /** The symbols collected */
+  int num; /** The number of symbols */
+  int capacity; /** The size of symbols */
+} Invalidation;
+
+/**
+ * Adds a symbol to the symbols of an invalidation, this is called by hashmap_iterate for every symbol
+ * @return: Always returns MAP_OK
+ */
+static int collectSymbol(any_t item, any_t data) {
+  Invalidation* invalidation = (Invalidation*) item;
+  if (invalidation->num == invalidation->capacity) {
+    invalidation->capacity = 2 * invalidation->capacity + 16;
+    invalidation->symbols = realloc(invalidation->symbols, sizeof(SymbolIdent*) * invalidation->capacity);
+  }
+  invalidation->symbols[invalidation->num++] = (SymbolIdent*) data;
+  return MAP_OK;
+}
+
+/**
+ * Examines whether a tree uses one of a set of names, other than the arguments bound in it
+ * @param: The tree, the arguments bound in the tree, and the names
+ * @return: 1 if it does, 0 otherwise
+ */
+static int usesName(TreeNode* node, NameListNode* bound, map_t names) {
+  ValueType type = getType(node->value);
+  void* found;
+  if (type == ValueType_CONSTANT || type == ValueType_FUNCTION) {
+    char* name = getCharVal(node->value);
+    NameListNode* argument = type == ValueType_CONSTANT ? bound : NULL;
+    while (argument && strcmp(argument->name, name))
+      argument = argument->next;
+    if (!argument && hashmap_get(names, name, &found) == MAP_OK)
+      return 1;
+  }
+  for (PointerListNode* child = node->argList; child; child = child->next) {
+    if (usesName(child->target, bound, names))
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * Forgets everything derived from the old meaning of a name: the values, compiled code, inferred types and strict arguments of every symbol that uses it, directly or through other symbols.
+ * The symbols that use a name are found by following the edges from each symbol to the names its tree uses backwards, until no more symbols are reached
+ * @param: The name that was redefined
+ */
+static void invalidate(char* name) {
+  Invalidation invalidation = {hashmap_new(), NULL, 0, 0};
+  hashmap_put(invalidation.changed, name, name);
+  hashmap_iterate(context->symbols, collectSymbol, &invalidation);
+  void* found;
+  int grown = 1;
+  while (grown) {
+    grown = 0;
+    for (int i = 0; i < invalidation.num; i++) {
+      SymbolIdent* symbol = invalidation.symbols[i];
+      TreeNode* tree = symbol->expression ? symbol->expression : symbol->parseTree;
+      if (hashmap_get(invalidation.changed, symbol->name, &found) != MAP_OK &&
+	  usesName(tree, symbol->argNames, invalidation.changed)) {
+	hashmap_put(invalidation.changed, symbol->name, symbol);
+	symbol->calls = 0;
+	symbol->native = NULL;
+	symbol->typed = 0;
+	symbol->strictness = 0;
+	symbol->state = ThunkState_PENDING;
+	grown = 1;
+      }
+    }
+  }
+  hashmap_free(invalidation.changed);
+  free(invalidation.symbols);
+}
+
+/**
+ * Defines a function or value of the current interpreter, values are evaluated when they are first used.
+ * A name that is defined already gets the new definition, the old one is kept for evaluations that still use it
+ * @param: The declaration, and whether to print what was defined
+ * @return: InterpreterStatus_OK, or InterpreterStatus_REDEFINITION if the name is a built-in function
+ */
+static InterpreterStatus define(SymbolIdent* it, int verbose) {
+  void* old;
+  if (exists(it->name)) {
+    if (verbose)
+      printf("redefinition is not allowed\n");
+    return InterpreterStatus_REDEFINITION;
+  }
+  SymbolIdent* defined = it;
+  if (!it->argNames) {
+    defined = calloc(1, sizeof(SymbolIdent));
+    defined->name = it->name;
+    defined->parseTree = calloc(1, sizeof(TreeNode));
+    defined->expression = it->parseTree;
+    defined->state = ThunkState_PENDING;
+  }
+  int redefinition = hashmap_get(context->symbols, it->name, &old) == MAP_OK;
+  if (redefinition) {
+    hashmap_remove(context->symbols, it->name);
+    invalidate(it->name);
+  }
+  hashmap_put(context->symbols, it->name, defined);
+  if (verbose)
+    printf("%s %s%s\n", redefinition ? "Redefined" : "Defined", it->argNames ? "function " : "", it->name);
+  return InterpreterStatus_OK;
+}
+
+/**
+ * Defines the functions and values declared in a string
+ */
+InterpreterStatus interpreterDefine(Interpreter* interpreter, const char* source) {
+  Context* caller = context;
+  context = interpreter;
+  Parser* parser = parserNewString(source);
+  InterpreterStatus status = InterpreterStatus_OK;
+  SymbolIdent* it;
+  while (status == InterpreterStatus_OK && (it = parse(parser)) != PARSE_QUIT) {
+    if (!it)
+      status = InterpreterStatus_SYNTAX_ERROR;
+    else if (!it->name) {
+      freeSymbol(it);
+      status = InterpreterStatus_NOT_DEFINITION;
+    }
+    else
+      status = define(it, 0);
+  }
+  parserFree(parser);
+  context = caller;
+  return status;
+}
+
+/**
+ * Evaluates the expression in a string
+ */
+InterpreterStatus interpreterEval(Interpreter* interpreter, const char* source, Val* result) {
+  Context* caller = context;
+  context = interpreter;
+  Parser* parser = parserNewString(source);
+  SymbolIdent* it = parse(parser);
+  InterpreterStatus status = InterpreterStatus_OK;
+  if (!it)
+    status = InterpreterStatus_SYNTAX_ERROR;
+  else if (it == PARSE_QUIT)
+    status = InterpreterStatus_EMPTY;
+  else if (it->name)
+    status = InterpreterStatus_NOT_EXPRESSION;
+  else {
+    *result = evalCached(it->parseTree);
+    freeSymbol(it);
+  }
+  parserFree(parser);
+  context = caller;
+  return status;
+}
+
+/**
+ * Defines a declaration of the current interpreter, or evaluates it and writes its value to stdout
+ */
+static void run(SymbolIdent* it) {
+  if (it->name)
+    define(it, outputMode == OutputMode_TEXT);
+  else {
+    Val calced = evalCached(it->parseTree);
+    writeResult(stdout, calced);
+    freeSymbol(it);
+    freeVal(calced);
+  }
+}
+
+/**
+ * Runs the interpreter loop
+ */
+void interpreterRun(Interpreter* interpreter, FILE* in, FILE* fallback) {
+  Context* caller = context;
+  context = interpreter;
+  Parser* parser = parserNew(in, fallback);
+  SymbolIdent* it;
+  while ((it = parse(parser)) != PARSE_QUIT) {
+    if (it)
+      run(it);
+  }
+  parserFree(parser);
+  context = caller;
+}
+
+/**
+ * The loop of the parsing thread of a pipeline, parses declarations into the queue until the input ends
+ * @return: Always returns 0
+ */
+static void* pipelineParse(void* arguments) {
+  Pipeline* pipeline = (Pipeline*) arguments;
+  SymbolIdent* it;
+  do {
+    it = parse(pipeline->parser);
+    if (!it)
+      continue;
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->num == pipeline->capacity)
+      pthread_cond_wait(&pipeline->notFull, &pipeline->lock);
+    pipeline->queue[(pipeline->head + pipeline->num++) % pipeline->capacity] = it;
+    pthread_cond_signal(&pipeline->notEmpty);
+    pthread_mutex_unlock(&pipeline->lock);
+  } while (it != PARSE_QUIT);
+  statsThreadExit();
+  traceThreadExit();
+  return 0;
+}
+
+/**
+ * Runs the interpreter loop with parsing and evaluation on different threads
+ */
+void interpreterRunPipelined(Interpreter* interpreter, FILE* in, FILE* fallback, int depth) {
+  Context* caller = context;
+  context = interpreter;
+  Pipeline pipeline;
+  pipeline.parser = parserNew(in, fallback);
+  pipeline.capacity = depth > 0 ? depth : 1;
+  pipeline.queue = malloc(sizeof(SymbolIdent*) * pipeline.capacity);
+  pipeline.head = 0;
+  pipeline.num = 0;
+  pthread_mutex_init(&pipeline.lock, NULL);
+  pthread_cond_init(&pipeline.notEmpty, NULL);
+  pthread_cond_init(&pipeline.notFull, NULL);
+  pthread_t parsing;
+  pthread_create(&parsing, NULL, pipelineParse, &pipeline);
+  while (1) {
+    pthread_mutex_lock(&pipeline.lock);
+    while (!pipeline.num)
+      pthread_cond_wait(&pipeline.notEmpty, &pipeline.lock);
+    SymbolIdent* it = pipeline.queue[pipeline.head];
+    pipeline.head = (pipeline.head + 1) % pipeline.capacity;
+    pipeline.num--;
+    pthread_cond_signal(&pipeline.notFull);
+    pthread_mutex_unlock(&pipeline.lock);
+    if (it == PARSE_QUIT)
+      break;
+    run(it);
+  }
+  pthread_join(parsing, NULL);
+  parserFree(pipeline.parser);
+  pthread_mutex_destroy(&pipeline.lock);
+  pthread_cond_destroy(&pipeline.notEmpty);
+  pthread_cond_destroy(&pipeline.notFull);
+  free(pipeline.queue);
+  context = caller;
+}
+
+/**
+ * Makes a task depend on another, unless the other is done
+ */
+static void addDependency(BatchEntry* task, BatchEntry* on) {
+  if (on->done)
+    return;
+  for (int i = 0; i < on->dependentNum; i++) {
+    if (on->dependents[i] == task)
+      return;
+  }
+  if (on->dependentNum == on->dependentCapacity) {
+    on->dependentCapacity = 2 * on->dependentCapacity + 4;
+    on->dependents = realloc(on->dependents, sizeof(BatchEntry*) * on->dependentCapacity);
+  }
+  on->dependents[on->dependentNum++] = task;
+  task->waiting++;
+}
+
+/**
+ * Finds the values a tree uses, directly or through the functions it calls, and makes a task depend on the tasks that compute them
+ * @param: The task, the tree, the arguments bound in the tree, the names already followed, and the declarations of the batch before the task by name
+ * @return: 0 if the tree uses a name that is not defined before the task, 1 otherwise
+ */
+static int findDependencies(BatchEntry* task, TreeNode* node, NameListNode* bound, map_t visited, map_t declared) {
+  ValueType type = getType(node->value);
+  if (type == ValueType_CONSTANT || type == ValueType_FUNCTION) {
+    char* name = getCharVal(node->value);
+    NameListNode* argument = type == ValueType_CONSTANT ? bound : NULL;
+    while (argument && strcmp(argument->name, name))
+      argument = argument->next;
+    void* found;
+    if (!argument && !exists(name) && strcmp(name, "ite") &&
+	hashmap_get(visited, name, &found) != MAP_OK) {
+      hashmap_put(visited, name, name);
+      BatchEntry* entry;
+      SymbolIdent* symbol;
+      if (hashmap_get(declared, name, (any_t*) &entry) == MAP_OK) {
+	if (entry->constant)
+	  addDependency(task, entry);
+	else if (!findDependencies(task, entry->declaration->parseTree, entry->declaration->argNames, visited, declared))
+	  return 0;
+      }
+      else if (hashmap_get(context->symbols, name, (any_t*) &symbol) == MAP_OK) {
+	if (symbol->argNames && !findDependencies(task, symbol->parseTree, symbol->argNames, visited, declared))
+	  return 0;
+      }
+      else {
+	return 0;
+      }
+    }
+  }
+  for (PointerListNode* child = node->argList; child; child = child->next) {
+    if (!findDependencies(task, child->target, bound, visited, declared))
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * Evaluates a task of a batch, writing what it prints to its text
+ */
+static void runTask(BatchEntry* task) {
+  FILE* out = open_memstream(&task->text, &task->length);
+  if (task->constant) {
+    evalValue(task->constant);
+    if (outputMode == OutputMode_TEXT)
+      fprintf(out, "Defined %s\n", task->constant->name);
+  }
+  else
+    writeResult(out, evalCached(task->declaration->parseTree));
+  fclose(out);
+}
+
+/**
+ * The loop of a batch worker, runs ready tasks until every task has been taken
+ * @return: Always returns 0
+ */
+static void* batchWork(void* arguments) {
+  Batch* batch = (Batch*) arguments;
+  context = batch->interpreter;
+  pthread_mutex_lock(&batch->lock);
+  while (1) {
+    while (!batch->ready && batch->unstarted)
+      pthread_cond_wait(&batch->readyCond, &batch->lock);
+    if (!batch->ready)
+      break;
+    BatchEntry* task = batch->ready;
+    batch->ready = task->next;
+    batch->unstarted--;
+    pthread_mutex_unlock(&batch->lock);
+    runTask(task);
+    pthread_mutex_lock(&batch->lock);
+    task->done = 1;
+    for (int i = 0; i < task->dependentNum; i++) {
+      BatchEntry* dependent = task->dependents[i];
+      if (!--dependent->waiting) {
+	dependent->next = batch->ready;
+	batch->ready = dependent;
+      }
+    }
+    pthread_cond_broadcast(&batch->readyCond);
+    pthread_cond_broadcast(&batch->doneCond);
+  }
+  pthread_cond_broadcast(&batch->readyCond);
+  pthread_mutex_unlock(&batch->lock);
+  statsThreadExit();
+  traceThreadExit();
+  return 0;
+}
+
+/**
+ * Sets the text of an entry that is not evaluated
+ */
+static void setText(BatchEntry* entry, const char* format, const char* name) {
+  entry->text = NULL;
+  if (outputMode == OutputMode_TEXT) {
+    FILE* out = open_memstream(&entry->text, &entry->length);
+    fprintf(out, format, name);
+    fclose(out);
+  }
+  entry->done = 1;
+}
+
+/**
+ * Runs a whole input as a batch
+ */
+void interpreterRunBatch(Interpreter* interpreter, FILE* in, int workers) {
+  Context* caller = context;
+  context = interpreter;
+  Parser* parser = parserNew(in, NULL);
+  int num = 0;
+  int capacity = 64;
+  BatchEntry* entries = malloc(sizeof(BatchEntry) * capacity);
+  SymbolIdent* it;
+  while ((it = parse(parser)) != PARSE_QUIT) {
+    if (!it)
+      continue;
+    if (num == capacity) {
+      capacity *= 2;
+      entries = realloc(entries, sizeof(BatchEntry) * capacity);
+    }
+    memset(&entries[num], 0, sizeof(BatchEntry));
+    entries[num++].declaration = it;
+  }
+  parserFree(parser);
+
+  //Every value and expression is made to depend on the values it uses, the names it uses must be defined before it and only once
+  map_t declared = hashmap_new();
+  int resolved = 1;
+  void* found;
+  for (int i = 0; i < num && resolved; i++) {
+    BatchEntry* entry = &entries[i];
+    char* name = entry->declaration->name;
+    if (name && exists(name)) {
+      entry->redefinition = 1;
+      continue;
+    }
+    if (name && (hashmap_get(declared, name, &found) == MAP_OK || hashmap_get(context->symbols, name, &found) == MAP_OK)) {
+      resolved = 0;
+      break;
+    }
+    if (!name || !entry->declaration->argNames) {
+      map_t visited = hashmap_new();
+      entry->task = 1;
+      resolved = findDependencies(entry, entry->declaration->parseTree, NULL, visited, declared);
+      hashmap_free(visited);
+    }
+    if (name) {
+      hashmap_put(declared, name, entry);
+      if (!entry->declaration->argNames) {
+	entry->constant = calloc(1, sizeof(SymbolIdent));
+	entry->constant->name = name;
+	entry->constant->parseTree = calloc(1, sizeof(TreeNode));
+	entry->constant->expression = entry->declaration->parseTree;
+	entry->constant->state = ThunkState_PENDING;
+      }
+    }
+  }
+  hashmap_free(declared);
+  if (!resolved) {
+    //Using a name above its definition or defining it again means something else there, so the batch is run in order instead
+    for (int i = 0; i < num; i++) {
+      free(entries[i].dependents);
+      if (entries[i].constant) {
+	free(entries[i].constant->parseTree);
+	free(entries[i].constant);
+      }
+      run(entries[i].declaration);
+    }
+    free(entries);
+    context = caller;
+    return;
+  }
+
+  Batch batch;
+  batch.interpreter = interpreter;
+  batch.ready = NULL;
+  batch.unstarted = 0;
+  pthread_mutex_init(&batch.lock, NULL);
+  pthread_cond_init(&batch.readyCond, NULL);
+  pthread_cond_init(&batch.doneCond, NULL);
+  //The symbols are complete before any worker starts, so they are only read while the tasks run
+  for (int i = num - 1; i >= 0; i--) {
+    BatchEntry* entry = &entries[i];
+    if (entry->redefinition)
+      setText(entry, "redefinition is not allowed\n", NULL);
+    else if (entry->task) {
+      batch.unstarted++;
+      if (!entry->waiting) {
+	entry->next = batch.ready;
+	batch.ready = entry;
+      }
+    }
+    else
+      setText(entry, "Defined function %s\n", entry->declaration->name);
+  }
+  for (int i = 0; i < num; i++) {
+    if (entries[i].constant)
+      hashmap_put(context->symbols, entries[i].constant->name, entries[i].constant);
+    else if (entries[i].declaration->name && !entries[i].redefinition)
+      hashmap_put(context->symbols, entries[i].declaration->name, entries[i].declaration);
+  }
+  if (workers <= 0)
+    workers = sysconf(_SC_NPROCESSORS_ONLN);
+  pthread_t threads[workers];
+  for (int i = 0; i < workers; i++)
+    pthread_create(&threads[i], NULL, batchWork, &batch);
+
+  for (int i = 0; i < num; i++) {
+    BatchEntry* entry = &entries[i];
+    pthread_mutex_lock(&batch.lock);
+    while (!entry->done)
+      pthread_cond_wait(&batch.doneCond, &batch.lock);
+    pthread_mutex_unlock(&batch.lock);
+    if (entry->text) {
+      fwrite(entry->text, 1, entry->length, stdout);
+      if (outputStreaming)
+	fflush(stdout);
+    }
+    free(entry->text);
+    free(entry->dependents);
+    if (!entry->declaration->name)
+      freeSymbol(entry->declaration);
+  }
+  for (int i = 0; i < workers; i++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&batch.lock);
+  pthread_cond_destroy(&batch.readyCond);
+  pthread_cond_destroy(&batch.doneCond);
+  free(entries);
+  context = caller;
+}
+
+/**
+ * Compiles a whole stream to a standalone C program
+ */
+InterpreterStatus interpreterCompile(Interpreter* interpreter, FILE* in, const char* path) {
+  Context* caller = context;
+  context = interpreter;
+  Parser* parser = parserNew(in, NULL);
+  int num = 0;
+  int capacity = 64;
+  SymbolIdent** declarations = malloc(sizeof(SymbolIdent*) * capacity);
+  SymbolIdent* it;
+  while ((it = parse(parser)) != PARSE_QUIT) {
+    if (!it)
+      continue;
+    if (num == capacity) {
+      capacity *= 2;
+      declarations = realloc(declarations, sizeof(SymbolIdent*) * capacity);
+    }
+    declarations[num++] = it;
+  }
+  parserFree(parser);
+  InterpreterStatus status = InterpreterStatus_OK;
+  FILE* out = fopen(path, "w");
+  if (!out) {
+    printf("Failed to open %s\n", path);
+    status = InterpreterStatus_FILE_ERROR;
+  }
+  else {
+    if (!compileProgram(declarations, num, out))
+      status = InterpreterStatus_NOT_COMPILABLE;
+    fclose(out);
+  }
+  free(declarations);
+  context = caller;
+  return status;
+}
+
+/**
+ * Frees an interpreter
+ */
+void interpreterFree(Interpreter* interpreter) {
+  hashmap_free(interpreter->symbols);
+  free(interpreter);
+}
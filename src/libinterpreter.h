@@ -0,0 +1,84 @@
+/**
+ * @brief: Header for the interpreter library, which runs any number of independent interpreters in one process.
+ * Every interpreter has its own symbols and its own thread limit, and different interpreters may be used from different threads at the same time. Several threads may evaluate expressions in one interpreter at once, but a definition must not run at the same time as anything else in the same interpreter.
+ * Hash-consing, output formats, profiling, statistics and tracing are settings of the whole process
+ * @file: libinterpreter.h
+ * @date: 19/10 2026
+ */
+
+#ifndef LIBINTERPRETER_HEADER
+#define LIBINTERPRETER_HEADER
+#include "structures.h"
+#include "hashmap.h"
+#include <stdio.h>
+
+typedef struct Context Interpreter; /** An interpreter instance, its fields are private to the library */
+
+/**
+ * The results of the library functions
+ */
+typedef enum InterpreterStatus {
+  InterpreterStatus_OK,
+  InterpreterStatus_SYNTAX_ERROR, /** A declaration could not be parsed */
+  InterpreterStatus_REDEFINITION, /** A declaration defines the name of a built-in function */
+  InterpreterStatus_NOT_EXPRESSION, /** interpreterEval was given a definition */
+  InterpreterStatus_NOT_DEFINITION, /** interpreterDefine was given an expression */
+  InterpreterStatus_EMPTY, /** There was no declaration to evaluate */
+  InterpreterStatus_NOT_COMPILABLE, /** A declaration can not be compiled */
+  InterpreterStatus_FILE_ERROR /** A file could not be written */
+} InterpreterStatus;
+
+/**
+ * Creates an interpreter with no symbols defined
+ */
+Interpreter* interpreterNew();
+/**
+ * Sets the maximum number of threads an interpreter forks to evaluate arguments in parallel, 0 evaluates sequentially
+ */
+void interpreterSetThreads(Interpreter* interpreter, int maxThreads);
+/**
+ * Obtains the symbols of an interpreter, for writing and loading images
+ * @return: the hashmap of the user-defined functions and symbols by name
+ */
+map_t interpreterSymbols(Interpreter* interpreter);
+/**
+ * Defines the functions and values declared in a string, such as "fun f(x) = x+1; val y = f(1);". Values are evaluated when they are first used. A name that is defined already gets the new definition, and the values that use it are evaluated again when they are next used
+ * @return: InterpreterStatus_OK if all declarations were defined, otherwise the status of the first one that was not, the declarations before it are kept
+ */
+InterpreterStatus interpreterDefine(Interpreter* interpreter, const char* source);
+/**
+ * Evaluates the expression in a string, such as "f(y);"
+ * @param: The interpreter, the string, and where to store the value
+ * @return: InterpreterStatus_OK if the value was stored
+ */
+InterpreterStatus interpreterEval(Interpreter* interpreter, const char* source, Val* result);
+/**
+ * Runs the interpreter loop, defining the declarations read from a stream and writing the values of the expressions to stdout, until quit or the end of the input
+ * @param: The interpreter, the stream, and the stream to continue from once the first ends, or NULL
+ */
+void interpreterRun(Interpreter* interpreter, FILE* in, FILE* fallback);
+/**
+ * Runs the interpreter loop like interpreterRun, but parses on a thread of its own, up to a number of declarations ahead of the one being evaluated.
+ * The declarations are still defined and evaluated one at a time in order. Syntax errors are reported when they are parsed, which may be before the values above them are written
+ * @param: The interpreter, the stream, the stream to continue from once the first ends or NULL, and the number of declarations to parse ahead
+ */
+void interpreterRunPipelined(Interpreter* interpreter, FILE* in, FILE* fallback, int depth);
+/**
+ * Runs a whole stream as a batch. Every declaration is parsed first, then the values and expressions are evaluated by a pool of workers, each as soon as the values it uses are known, and what they print is written to stdout in the order of the declarations.
+ * If a value or expression uses a name that is not defined above it, the declarations are run one at a time as interpreterRun does
+ * @param: The interpreter, the stream, and the number of workers, 0 for one per online processor
+ */
+void interpreterRunBatch(Interpreter* interpreter, FILE* in, int workers);
+/**
+ * Compiles a whole stream to a standalone C program, which prints what interpreterRun would print for the stream in text mode when it is run. The program may use the functions and values the interpreter has, but the interpreter is not changed.
+ * Everything but iterate, stats and unbounded lists can be compiled. The program is compiled with gcc -O2 -pthread
+ * @param: The interpreter, the stream, and the path of the C file to write
+ * @return: InterpreterStatus_OK if the file was written
+ */
+InterpreterStatus interpreterCompile(Interpreter* interpreter, FILE* in, const char* path);
+/**
+ * Frees an interpreter. Values it returned stay valid, as lists are never freed, except that the nodes of an iterate list not yet read can no longer be computed, since they call functions of the interpreter
+ */
+void interpreterFree(Interpreter* interpreter);
+
+#endif
@@ -0,0 +1,198 @@
+/**
+ * @brief: This is the file containing the implementation of integer list loading from binary and text files
+ * @file: loader.c
+ * @date: 19/10 2026
+ */
+#include "loader.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_LOAD_THREADS 64
+#define MIN_CHUNK (1 << 16) /** Text files smaller than this per thread are not worth splitting further */
+
+int loadThreads = 0;
+
+/**
+ * This defines the part of a text file that one thread parses.
+ */
+typedef struct {
+  const char* start; /** The first character of the chunk */
+  const char* end; /** One past the last character of the chunk */
+  int64_t* out; /** Where to write the numbers, NULL when only counting */
+  long count; /** The number of numbers in the chunk */
+  int malformed; /** Nonzero if the chunk holds a run of digits and minus signs that is not a number */
+} LoadChunk;
+
+/**
+ * Computes the node following a node of a loaded list
+ * @return: a new lazy node holding the next number, or NULL at the end of the data
+ */
+static ValList* loadedNext(ListThunk* thunk) {
+  if (thunk->length <= 0)
+    return NULL;
+  ListThunk generator = *thunk;
+  generator.length = thunk->length - 1;
+  generator.current = createVal(ValueType_INT, (intptr_t) ((int64_t*) thunk->source)[thunk->limit - thunk->length]);
+  return createLazyListNode(generator.current, &generator);
+}
+
+/**
+ * Builds a lazy list that reads its values from an array
+ * @return: the first node of the list, or NULL if the array is empty
+ */
+static ValList* viewIntegers(int64_t* data, long count) {
+  if (count <= 0)
+    return NULL;
+  Val first = createVal(ValueType_INT, (intptr_t) data[0]);
+  ListThunk generator = {loadedNext, count - 1, first, count, data, NULL, ThunkState_PENDING};
+  return createLazyListNode(first, &generator);
+}
+
+/**
+ * Checks wether a character is part of a number
+ */
+static int isNumberChar(char c) {
+  return (c >= '0' && c <= '9') || c == '-';
+}
+
+/**
+ * Counts or parses the numbers of one chunk, depending on wether the chunk has somewhere to write them
+ * @return: Always return 0
+ */
+static void* parseChunk(void* arguments) {
+  LoadChunk* chunk = (LoadChunk*) arguments;
+  const char* pos = chunk->start;
+  long count = 0;
+  chunk->malformed = 0;
+  while (pos < chunk->end) {
+    while (pos < chunk->end && !isNumberChar(*pos))
+      pos++;
+    if (pos == chunk->end)
+      break;
+    int negative = 0;
+    if (*pos == '-') {
+      negative = 1;
+      pos++;
+    }
+    int64_t value = 0;
+    const char* digits = pos;
+    while (pos < chunk->end && *pos >= '0' && *pos <= '9') {
+      value = value * 10 + (*pos - '0');
+      pos++;
+    }
+    //A minus sign is only a sign at the start of a number, 3-4 or a lone - is not a number
+    if (pos == digits || (pos < chunk->end && isNumberChar(*pos))) {
+      chunk->malformed = 1;
+      break;
+    }
+    if (chunk->out)
+      chunk->out[count] = negative ? -value : value;
+    count++;
+  }
+  chunk->count = count;
+  return 0;
+}
+
+/**
+ * Runs parseChunk on every chunk, one thread per chunk. A chunk whose thread could not be created is parsed by the calling thread
+ * @return: 1 if every chunk holds only numbers, 0 otherwise
+ */
+static int parseChunks(LoadChunk* chunks, int num) {
+  pthread_t ids[MAX_LOAD_THREADS];
+  int started[MAX_LOAD_THREADS];
+  for (int i = 1; i < num; i++)
+    started[i] = !pthread_create(&ids[i], NULL, parseChunk, &chunks[i]);
+  parseChunk(&chunks[0]);
+  for (int i = 1; i < num; i++) {
+    if (started[i])
+      pthread_join(ids[i], NULL);
+    else
+      parseChunk(&chunks[i]);
+  }
+  for (int i = 0; i < num; i++) {
+    if (chunks[i].malformed)
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * Parses a mapped text file into an array, splitting it at separators so that each thread gets whole numbers
+ * @return: the array of numbers, its size is written to count, or NULL if the file holds something that is not a number
+ */
+static int64_t* parseIntegers(const char* text, size_t size, long* count) {
+  int num = loadThreads > 0 ? loadThreads : (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (num > MAX_LOAD_THREADS)
+    num = MAX_LOAD_THREADS;
+  if (num > (long) (size / MIN_CHUNK))
+    num = size / MIN_CHUNK;
+  if (num < 1)
+    num = 1;
+  LoadChunk chunks[MAX_LOAD_THREADS];
+  const char* pos = text;
+  for (int i = 0; i < num; i++) {
+    chunks[i].start = pos;
+    pos = (i == num - 1) ? text + size : text + size / num * (i + 1);
+    if (pos < chunks[i].start)
+      pos = chunks[i].start;
+    while (pos < text + size && isNumberChar(*pos))
+      pos++;
+    chunks[i].end = pos;
+    chunks[i].out = NULL;
+  }
+  if (!parseChunks(chunks, num))
+    return NULL;
+  long total = 0;
+  for (int i = 0; i < num; i++)
+    total += chunks[i].count;
+  int64_t* data = malloc(sizeof(int64_t) * (total ? total : 1));
+  long offset = 0;
+  for (int i = 0; i < num; i++) {
+    chunks[i].out = data + offset;
+    offset += chunks[i].count;
+  }
+  parseChunks(chunks, num);
+  *count = total;
+  return data;
+}
+
+/**
+ * Loads a list of integers from a file.
+ * @return: the first node of the list, or NULL if the file is empty, malformed or could not be read
+ */
+ValList* loadIntegerList(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("Invalid file name or path\n");
+    return NULL;
+  }
+  struct stat info;
+  if (fstat(fd, &info) || info.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    printf("Failed to map %s\n", path);
+    return NULL;
+  }
+  size_t pathLength = strlen(path);
+  if (pathLength > 4 && !strcmp(path + pathLength - 4, ".bin"))
+    return viewIntegers((int64_t*) mapped, info.st_size / sizeof(int64_t));
+  long count;
+  int64_t* data = parseIntegers((const char*) mapped, info.st_size, &count);
+  munmap(mapped, info.st_size);
+  if (!data) {
+    printf("%s holds a malformed number\n", path);
+    return NULL;
+  }
+  return viewIntegers(data, count);
+}
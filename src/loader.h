@@ -0,0 +1,22 @@
+/**
+ * @brief: Header for loading integer lists from files, used by the load directive in the parser
+ * @file: loader.h
+ * @date: 19/10 2026
+ */
+
+#ifndef LOADER_HEADER
+#define LOADER_HEADER
+#include "structures.h"
+
+extern int loadThreads; /** The number of threads used to parse text files, 0 means one per online processor */
+
+/**
+ * Loads a list of integers from a file.
+ * Files ending in .bin are read as raw native-endian 64 bit integers and the list is a view over the mapped file.
+ * Any other file is read as integers separated by newlines, commas or whitespace, parsed in parallel into one array that the list is a view over. A minus sign may only start a number, a file holding something like 3-4 or a lone - is not loaded.
+ * The nodes of the list are created as it is traversed.
+ * @return: the first node of the list, or NULL if the file is empty, malformed or could not be read
+ */
+ValList* loadIntegerList(const char* path);
+
+#endif
@@ -0,0 +1,153 @@
+/**
+ * @brief: This is the file containing a load generator for the server mode, which sends pipelined requests from several clients and reports the throughput and the latency percentiles
+ * @file: loadgen.c
+ * @date: 19/10 2026
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Defines the work and the measurements of one client.
+ */
+typedef struct {
+  uint64_t* latencies; /** Nanoseconds from sending each request to reading its answer */
+  long errors; /** The number of answers that were errors */
+  int failed; /** Nonzero if the client could not connect */
+} Client;
+
+const char* socketPath = NULL; /** The socket of the server */
+const char* expression = "fib(10)"; /** The line every request sends */
+int REQUESTS = 1000; /** The number of requests per client */
+int DEPTH = 8; /** The number of requests a client keeps in flight */
+
+/**
+ * Obtains the current time
+ * @return: a monotonic time in nanoseconds
+ */
+static uint64_t nowNs() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/**
+ * Runs one client, keeping DEPTH requests in flight until all are answered
+ * @return: Always return 0
+ */
+static void* runClient(void* argument) {
+  Client* client = (Client*) argument;
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(address))) {
+    client->failed = 1;
+    return 0;
+  }
+  size_t lineLength = strlen(expression) + 1;
+  char* line = malloc(lineLength + 1);
+  sprintf(line, "%s\n", expression);
+  uint64_t* sentAt = malloc(sizeof(uint64_t) * REQUESTS);
+  long sent = 0;
+  long received = 0;
+  int lineStart = 1;
+  char buffer[65536];
+  while (received < REQUESTS) {
+    while (sent < REQUESTS && sent - received < DEPTH) {
+      sentAt[sent++] = nowNs();
+      if (write(fd, line, lineLength) != (ssize_t) lineLength) {
+	client->failed = 1;
+	return 0;
+      }
+    }
+    ssize_t got = read(fd, buffer, sizeof(buffer));
+    if (got <= 0) {
+      client->failed = 1;
+      return 0;
+    }
+    uint64_t now = nowNs();
+    for (ssize_t i = 0; i < got; i++) {
+      if (lineStart && buffer[i] == 'e')
+	client->errors++;
+      lineStart = buffer[i] == '\n';
+      if (lineStart) {
+	client->latencies[received] = now - sentAt[received];
+	received++;
+      }
+    }
+  }
+  close(fd);
+  free(sentAt);
+  free(line);
+  return 0;
+}
+
+/**
+ * Orders latencies ascending
+ */
+static int compareLatencies(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*) a;
+  uint64_t y = *(const uint64_t*) b;
+  return x < y ? -1 : x > y;
+}
+
+/**
+ * Runs the load generator
+ * @param: -s socket (required), -c clients, -n requests per client, -d requests in flight per client, -e the expression to send
+ * @return: 0 if every client finished, 1 otherwise
+ */
+int main(int argv, char* argc[]) {
+  int clients = 4;
+  for (int n = 1; n < argv - 1; n++) {
+    if (!strcmp(argc[n],"-s"))
+      socketPath = argc[++n];
+    else if (!strcmp(argc[n],"-c"))
+      clients = atoi(argc[++n]);
+    else if (!strcmp(argc[n],"-n"))
+      REQUESTS = atoi(argc[++n]);
+    else if (!strcmp(argc[n],"-d"))
+      DEPTH = atoi(argc[++n]);
+    else if (!strcmp(argc[n],"-e"))
+      expression = argc[++n];
+  }
+  if (!socketPath || clients < 1 || REQUESTS < 1 || DEPTH < 1) {
+    printf("usage: loadgen -s socket [-c clients] [-n requests] [-d depth] [-e expression]\n");
+    return 1;
+  }
+  Client* all = calloc(clients, sizeof(Client));
+  pthread_t* threads = malloc(sizeof(pthread_t) * clients);
+  uint64_t start = nowNs();
+  for (int i = 0; i < clients; i++) {
+    all[i].latencies = malloc(sizeof(uint64_t) * REQUESTS);
+    pthread_create(&threads[i], NULL, runClient, &all[i]);
+  }
+  for (int i = 0; i < clients; i++)
+    pthread_join(threads[i], NULL);
+  double seconds = (nowNs() - start) / 1e9;
+
+  long total = (long) clients * REQUESTS;
+  long errors = 0;
+  uint64_t* latencies = malloc(sizeof(uint64_t) * total);
+  for (int i = 0; i < clients; i++) {
+    if (all[i].failed) {
+      printf("Client %d failed, is the server running on %s?\n", i, socketPath);
+      return 1;
+    }
+    memcpy(latencies + (long) i * REQUESTS, all[i].latencies, sizeof(uint64_t) * REQUESTS);
+    errors += all[i].errors;
+  }
+  qsort(latencies, total, sizeof(uint64_t), compareLatencies);
+  printf("requests=%ld errors=%ld seconds=%.3f requests_per_s=%.0f\n", total, errors, seconds, total / seconds);
+  printf("latency_us p50=%.1f p90=%.1f p99=%.1f max=%.1f\n", latencies[total / 2] / 1e3, latencies[total * 9 / 10] / 1e3,
+	 latencies[total * 99 / 100] / 1e3, latencies[total - 1] / 1e3);
+  return 0;
+}
@@ -0,0 +1,268 @@
+/**
+ * @brief: This is the file containing microbenchmarks of the runtime building blocks, measured in isolation and compared against a stored baseline
+ * @file: microbench.c
+ * @date: 19/10 2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "structures.h"
+#include "hashmap.h"
+#include "eval.h"
+
+#define MAX_BENCHMARKS 16
+#define NAME_LENGTH 32
+
+/**
+ * Defines the result of one benchmark.
+ */
+typedef struct {
+  char name[NAME_LENGTH]; /** The name of the benchmark */
+  double ns; /** Nanoseconds per operation */
+  double cycles; /** Cycles per operation, 0 where no cycle counter is available */
+} BenchResult;
+
+BenchResult results[MAX_BENCHMARKS];
+int resultNum = 0;
+
+int OPS = 1000000; /** The number of operations for the cheap benchmarks */
+int LIST_LENGTH = 1000; /** The length of the lists used by the list benchmarks */
+int FORKS = 2000; /** The number of thread round-trips */
+volatile intptr_t sink; /** Keeps the compiler from removing measured work */
+
+/**
+ * Obtains the current time
+ * @return: a monotonic time in nanoseconds
+ */
+static uint64_t nowNs() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/**
+ * Obtains the cycle counter, if the processor has one that can be read
+ * @return: the number of cycles, or 0
+ */
+static uint64_t nowCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t low, high;
+  __asm__ __volatile__ ("rdtsc" : "=a" (low), "=d" (high));
+  return ((uint64_t) high << 32) | low;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Defines the start of a measurement.
+ */
+typedef struct {
+  uint64_t ns; /** The time at the start */
+  uint64_t cycles; /** The cycle counter at the start */
+} BenchStart;
+
+static BenchStart startBench() {
+  BenchStart start = {nowNs(), nowCycles()};
+  return start;
+}
+
+/**
+ * Records a benchmark result and prints it
+ */
+static void endBench(const char* name, BenchStart start, long ops) {
+  uint64_t cycles = nowCycles() - start.cycles;
+  uint64_t ns = nowNs() - start.ns;
+  BenchResult* result = &results[resultNum++];
+  strncpy(result->name, name, NAME_LENGTH - 1);
+  result->name[NAME_LENGTH - 1] = '\0';
+  result->ns = (double) ns / ops;
+  result->cycles = (double) cycles / ops;
+  printf("%-20s %12.2f ns/op %12.2f cycles/op\n", name, result->ns, result->cycles);
+}
+
+/**
+ * Builds a list of the numbers 0..length-1
+ * @return: the list
+ */
+static Val buildList(int length) {
+  ValList* list = NULL;
+  for (int i = length - 1; i >= 0; i--)
+    list = createListNode(createVal(ValueType_INT, i), list);
+  return createVal(ValueType_LIST, (intptr_t) list);
+}
+
+/**
+ * Builds a parse tree node
+ * @return: the node, with the arguments given as a NULL terminated list
+ */
+static TreeNode* buildNode(Val value, TreeNode* arg1, TreeNode* arg2) {
+  TreeNode* node = calloc(1, sizeof(TreeNode));
+  node->value = value;
+  node->argList = NULL;
+  TreeNode* args[2] = {arg1, arg2};
+  PointerListNode** field = &node->argList;
+  for (int i = 0; i < 2 && args[i]; i++) {
+    *field = malloc(sizeof(PointerListNode));
+    (*field)->target = args[i];
+    (*field)->next = NULL;
+    field = &(*field)->next;
+  }
+  return node;
+}
+
+static void benchHashmap() {
+  map_t map = hashmap_new();
+  char** keys = malloc(sizeof(char*) * OPS);
+  for (int i = 0; i < OPS; i++) {
+    keys[i] = malloc(16);
+    sprintf(keys[i], "k%d", i);
+  }
+  BenchStart start = startBench();
+  for (int i = 0; i < OPS; i++)
+    hashmap_put(map, keys[i], keys[i]);
+  endBench("hashmap_put", start, OPS);
+  any_t found;
+  start = startBench();
+  for (int i = 0; i < OPS; i++) {
+    hashmap_get(map, keys[i], &found);
+    sink = (intptr_t) found;
+  }
+  endBench("hashmap_get", start, OPS);
+  hashmap_free(map);
+}
+
+static void benchLists() {
+  Val list1 = buildList(LIST_LENGTH);
+  Val list2 = buildList(LIST_LENGTH);
+  int rounds = OPS / LIST_LENGTH > 0 ? OPS / LIST_LENGTH : 1;
+  BenchStart start = startBench();
+  for (int i = 0; i < rounds; i++)
+    sink = getListLength(list1);
+  endBench("getListLength/node", start, (long) rounds * LIST_LENGTH);
+  start = startBench();
+  for (int i = 0; i < rounds; i++)
+    sink = getListsEqual(list1, list2);
+  endBench("getListsEqual/node", start, (long) rounds * LIST_LENGTH);
+  Val list = createVal(ValueType_LIST, (intptr_t) NULL);
+  Val one = createVal(ValueType_INT, 1);
+  start = startBench();
+  for (int i = 0; i < OPS; i++)
+    list = evalCons(one, list);
+  endBench("evalCons", start, OPS);
+  sink = list.value.intval;
+}
+
+static void benchFork() {
+  TreeNode* leaf = buildNode(createVal(ValueType_INT, 1), NULL, NULL);
+  Val result;
+  ForkArgs args = {leaf, NULL, 0, &result, NULL, NULL};
+  void* bogus;
+  BenchStart start = startBench();
+  for (int i = 0; i < FORKS; i++) {
+    pthread_t id = doFork(&args);
+    pthread_join(id, &bogus);
+  }
+  endBench("doFork+join", start, FORKS);
+}
+
+static void benchEval() {
+  int saved = context->maxThreads;
+  context->maxThreads = 0;
+  //plus(mult(2,3),minus(5,1)) is seven nodes
+  TreeNode* tree = buildNode(createVal(ValueType_FUNCTION, (intptr_t) "plus"),
+			     buildNode(createVal(ValueType_FUNCTION, (intptr_t) "mult"),
+				       buildNode(createVal(ValueType_INT, 2), NULL, NULL),
+				       buildNode(createVal(ValueType_INT, 3), NULL, NULL)),
+			     buildNode(createVal(ValueType_FUNCTION, (intptr_t) "minus"),
+				       buildNode(createVal(ValueType_INT, 5), NULL, NULL),
+				       buildNode(createVal(ValueType_INT, 1), NULL, NULL)));
+  BenchStart start = startBench();
+  for (int i = 0; i < OPS / 7; i++)
+    sink = getIntVal(eval(tree, NULL, 0));
+  endBench("eval/node", start, (long) (OPS / 7) * 7);
+  context->maxThreads = saved;
+}
+
+/**
+ * Writes the results as a baseline file
+ * @return: 0 if the file was written, 1 otherwise
+ */
+static int writeBaseline(const char* path) {
+  FILE* out = fopen(path, "w");
+  if (!out) {
+    printf("Failed to open %s\n", path);
+    return 1;
+  }
+  for (int i = 0; i < resultNum; i++)
+    fprintf(out, "%s %.2f\n", results[i].name, results[i].ns);
+  fclose(out);
+  printf("Wrote baseline %s\n", path);
+  return 0;
+}
+
+/**
+ * Compares the results against a baseline file
+ * @return: the number of benchmarks that are slower than the baseline by more than the tolerance
+ */
+static int compareBaseline(const char* path, double tolerance) {
+  FILE* in = fopen(path, "r");
+  if (!in) {
+    printf("Failed to open baseline %s\n", path);
+    return 1;
+  }
+  int regressions = 0;
+  char name[NAME_LENGTH];
+  double ns;
+  while (fscanf(in, "%31s %lf", name, &ns) == 2) {
+    for (int i = 0; i < resultNum; i++) {
+      if (!strcmp(results[i].name, name)) {
+	double change = (results[i].ns - ns) / ns;
+	int slower = change > tolerance;
+	printf("%-20s baseline %10.2f ns/op now %10.2f ns/op %+7.1f%%%s\n", name, ns, results[i].ns, 100 * change, slower ? " REGRESSION" : "");
+	regressions += slower;
+      }
+    }
+  }
+  fclose(in);
+  return regressions;
+}
+
+/**
+ * Runs the microbenchmarks
+ * @param: -n operations, -l list length, -f thread round-trips, -b baseline file to compare against, -w baseline file to write, -t tolerated slowdown as a fraction
+ * @return: the number of regressions against the baseline
+ */
+int main(int argv, char* argc[]) {
+  char* baseline = NULL;
+  char* output = NULL;
+  double tolerance = 0.25;
+  Context bench = {hashmap_new(), 10, 0};
+  context = &bench;
+  for (int n = 1; n < argv - 1; n++) {
+    if (!strcmp(argc[n],"-n"))
+      OPS = atoi(argc[++n]);
+    else if (!strcmp(argc[n],"-l"))
+      LIST_LENGTH = atoi(argc[++n]);
+    else if (!strcmp(argc[n],"-f"))
+      FORKS = atoi(argc[++n]);
+    else if (!strcmp(argc[n],"-b"))
+      baseline = argc[++n];
+    else if (!strcmp(argc[n],"-w"))
+      output = argc[++n];
+    else if (!strcmp(argc[n],"-t"))
+      tolerance = atof(argc[++n]);
+  }
+  benchHashmap();
+  benchLists();
+  benchFork();
+  benchEval();
+  if (output)
+    return writeBaseline(output);
+  if (baseline)
+    return compareBaseline(baseline, tolerance);
+  return 0;
+}
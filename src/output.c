@@ -0,0 +1,206 @@
+/**
+ * @brief: This is the file containing the implementation of the value serializer
+ * @file: output.c
+ * @date: 19/10 2026
+ */
+#include "output.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+#define INITIAL_DEPTH 16
+
+OutputMode outputMode = OutputMode_TEXT;
+int outputStreaming = 0;
+
+/**
+ * Defines a buffer in front of a stream.
+ */
+typedef struct {
+  FILE* out; /** The stream the buffer is written to */
+  OutputMode mode; /** The format the buffer is written in */
+  size_t used; /** The number of bytes in data */
+  char data[OUTPUT_BUFFER_SIZE]; /** The buffered bytes */
+} OutputBuffer;
+
+/**
+ * Writes the buffered bytes to the stream
+ */
+static void flushBuffer(OutputBuffer* buffer) {
+  if (buffer->used) {
+    fwrite(buffer->data, 1, buffer->used, buffer->out);
+    buffer->used = 0;
+  }
+}
+
+/**
+ * Appends bytes to the buffer, flushing it when it is full
+ */
+static void putBytes(OutputBuffer* buffer, const char* bytes, size_t length) {
+  if (buffer->used + length > OUTPUT_BUFFER_SIZE)
+    flushBuffer(buffer);
+  memcpy(buffer->data + buffer->used, bytes, length);
+  buffer->used += length;
+}
+
+/**
+ * Appends one byte to the buffer, flushing it when it is full
+ */
+static void putByte(OutputBuffer* buffer, char byte) {
+  if (buffer->used == OUTPUT_BUFFER_SIZE)
+    flushBuffer(buffer);
+  buffer->data[buffer->used++] = byte;
+}
+
+/**
+ * Appends an int to the buffer in the current output mode
+ */
+static void putInt(OutputBuffer* buffer, intptr_t value) {
+  char digits[24];
+  if (buffer->mode == OutputMode_BINARY) {
+    uint64_t bits = (uint64_t) (int64_t) value;
+    digits[0] = 'i';
+    for (int i = 0; i < 8; i++)
+      digits[1+i] = (char) (bits >> (8*i));
+    putBytes(buffer, digits, 9);
+    return;
+  }
+  char* pos = digits + sizeof(digits);
+  uintptr_t magnitude = value < 0 ? -(uintptr_t) value : (uintptr_t) value;
+  do {
+    *--pos = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0)
+    *--pos = '-';
+  putBytes(buffer, pos, digits + sizeof(digits) - pos);
+}
+
+/**
+ * Appends a value that can not be printed to the buffer
+ */
+static void putUnprintable(OutputBuffer* buffer) {
+  if (buffer->mode == OutputMode_BINARY)
+    putByte(buffer, 'n');
+  else
+    putBytes(buffer, "NI", 2);
+}
+
+/**
+ * Obtains the node following a node of a list that is being written, flushing the buffer first if the node has to be computed and output is streamed
+ * @return: the next node
+ */
+static ValList* nextWritten(OutputBuffer* buffer, ValList* node) {
+  if (outputStreaming && node->rest && node->rest->state != ThunkState_DONE) {
+    flushBuffer(buffer);
+    fflush(buffer->out);
+  }
+  return getNextNode(node);
+}
+
+/**
+ * Defines the position in a list or vector that is being written.
+ */
+typedef struct {
+  ValList* node; /** The node being written, NULL for a vector */
+  Vector* vector; /** The vector being written, NULL for a list */
+  intptr_t index; /** The index of the element of the vector being written */
+} OutputPosition;
+
+/**
+ * Writes a value into a buffer, keeping the positions in enclosing lists and vectors on an explicit stack
+ */
+static void bufferVal(OutputBuffer* buffer, Val v) {
+  int textMode = buffer->mode == OutputMode_TEXT;
+  size_t depth = 0;
+  size_t capacity = INITIAL_DEPTH;
+  OutputPosition* stack = malloc(sizeof(OutputPosition) * capacity);
+  while (1) {
+    int empty = 0;
+    switch (getType(v)) {
+    case ValueType_INT:
+      putInt(buffer, getIntVal(v));
+      break;
+    case ValueType_LIST:
+    case ValueType_VECTOR:
+      putByte(buffer, getType(v) == ValueType_LIST ? '[' : '{');
+      empty = getType(v) == ValueType_LIST ? !getListVal(v) : !getVectorVal(v)->length;
+      if (!empty) {
+	if (depth == capacity) {
+	  capacity *= 2;
+	  stack = realloc(stack, sizeof(OutputPosition) * capacity);
+	}
+	OutputPosition* position = &stack[depth++];
+	position->node = getType(v) == ValueType_LIST ? getListVal(v) : NULL;
+	position->vector = getType(v) == ValueType_VECTOR ? getVectorVal(v) : NULL;
+	position->index = 0;
+	v = position->node ? position->node->value : position->vector->elements[0];
+	continue;
+      }
+      putByte(buffer, getType(v) == ValueType_LIST ? ']' : '}');
+      break;
+    default:
+      putUnprintable(buffer);
+      break;
+    }
+    //The current item is written, move on to the item after it, closing every list and vector that ends here
+    while (depth) {
+      OutputPosition* position = &stack[depth-1];
+      int more;
+      if (position->node) {
+	ValList* next = nextWritten(buffer, position->node);
+	more = next != NULL;
+	if (more) {
+	  position->node = next;
+	  v = next->value;
+	}
+      }
+      else {
+	more = ++position->index < position->vector->length;
+	if (more)
+	  v = position->vector->elements[position->index];
+      }
+      if (more) {
+	if (textMode)
+	  putByte(buffer, ',');
+	break;
+      }
+      putByte(buffer, position->node ? ']' : '}');
+      depth--;
+    }
+    if (!depth)
+      break;
+  }
+  free(stack);
+}
+
+/**
+ * Writes a value to a stream in the given output mode.
+ */
+void writeVal(FILE* out, Val v, OutputMode mode) {
+  OutputBuffer* buffer = malloc(sizeof(OutputBuffer));
+  buffer->out = out;
+  buffer->mode = mode;
+  buffer->used = 0;
+  bufferVal(buffer, v);
+  flushBuffer(buffer);
+  free(buffer);
+}
+
+/**
+ * Writes a value to a stream in the current output mode, followed by a newline in text mode
+ */
+void writeResult(FILE* out, Val v) {
+  OutputBuffer* buffer = malloc(sizeof(OutputBuffer));
+  buffer->out = out;
+  buffer->mode = outputMode;
+  buffer->used = 0;
+  bufferVal(buffer, v);
+  if (outputMode == OutputMode_TEXT)
+    putByte(buffer, '\n');
+  flushBuffer(buffer);
+  if (outputStreaming)
+    fflush(out);
+  free(buffer);
+}
@@ -0,0 +1,33 @@
+/**
+ * @brief: Header for the value serializer, which writes values through a large buffer without recursion
+ * @file: output.h
+ * @date: 19/10 2026
+ */
+
+#ifndef OUTPUT_HEADER
+#define OUTPUT_HEADER
+#include "structures.h"
+#include <stdio.h>
+
+/**
+ *Enumerates the formats values can be written in
+ */
+typedef enum OutputMode {
+  OutputMode_TEXT, /** Lists as [node1,node2...nodeN], vectors as {element1,element2...elementN}, ints in decimal */
+  OutputMode_BINARY /** A tag byte per item: 'i' followed by a little-endian 64 bit int, '[' and ']' around the items of a list, '{' and '}' around the items of a vector, 'n' for anything else */
+} OutputMode;
+
+extern OutputMode outputMode; /** The format results are written in */
+extern int outputStreaming; /** Nonzero if written output should be flushed before the tail of a lazy list is computed */
+
+/**
+ * Writes a value to a stream in the given output mode.
+ * Lists and vectors are walked iteratively, so deeply nested lists do not grow the call stack, and the output is formatted into a buffer that is written in large blocks.
+ */
+void writeVal(FILE* out, Val v, OutputMode mode);
+/**
+ * Writes a value to a stream in the current output mode, followed by a newline in text mode
+ */
+void writeResult(FILE* out, Val v);
+
+#endif
@@ -3,6 +3,39 @@
 #include "structures.h"
 #include <stdio.h>
 
-SymbolIdent* parse(FILE* inStream, FILE* debug);
+#define PARSE_QUIT ((SymbolIdent*) (intptr_t) 5) /** Returned by parse when the input asks to quit or has ended */
+
+/**
+ * Defines the state of one parser, which is independent of every other parser
+ */
+typedef struct Parser {
+  void* scanner; /** The reentrant scanner */
+  FILE* fallback; /** The stream to continue from when a file ends, NULL to end the input */
+  FILE* included; /** The file opened by a file directive, if it has not ended yet */
+  const char* source; /** The string being parsed, NULL once it has ended or when parsing streams */
+} Parser;
+
+/**
+ * Creates a parser reading a stream
+ * @param: The stream, and the stream to continue from once it and any file it includes have ended, or NULL
+ */
+Parser* parserNew(FILE* in, FILE* fallback);
+/**
+ * Creates a parser reading a string, the string is copied
+ */
+Parser* parserNewString(const char* source);
+/**
+ * Makes a parser continue with a file when the current input needs more characters
+ */
+void parserInclude(Parser* parser, FILE* file);
+/**
+ * Frees a parser, but not the streams it reads
+ */
+void parserFree(Parser* parser);
+/**
+ * Parses the next declaration
+ * @return: the declaration, PARSE_QUIT at the end of the input, or NULL if the declaration could not be parsed
+ */
+SymbolIdent* parse(Parser* parser);
 
 #endif
@@ -5,45 +5,90 @@
 #include <stdlib.h>
 
   extern char* strdup(const char*);
-  extern FILE* yyin;
-  FILE* debugout;
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+  typedef void* yyscan_t;
+#endif
 
 }
 
-%{
+%code {
 #include <stdio.h>
+#include <string.h>
 #include "structures.h"
 #include "parser.h"
-#define DPRINT(...) if (debugout) {fprintf(debugout,__VA_ARGS__);}
+#include "loader.h"
+#include "stats.h"
+#include "trace.h"
 
-extern FILE* yyin;
-FILE* debugout; 
+int yylex(YYSTYPE* lvalp, yyscan_t scanner);
+Parser* yyget_extra(yyscan_t scanner);
 
-SymbolIdent* it = NULL;
-  
-void yyerror(const char *str)
+void yyerror(yyscan_t scanner, SymbolIdent** result, const char *str)
 {
   //fprintf(stderr,"error: %s\n",str);
 }
- 
-int yywrap()
-{
-  fclose(yyin); 
-  yyrestart(stdin);
-  return 0;
-} 
 
-SymbolIdent* parse(FILE* inStream, FILE* debugStream) {
-  debugout = debugStream;
-  if (inStream != NULL)
-    yyin = inStream;
-  if (!yyparse())
-    return it;
+/**
+ * Parses the next declaration
+ * @return: the declaration, PARSE_QUIT at the end of the input, or NULL if the declaration could not be parsed
+ */
+SymbolIdent* parse(Parser* parser) {
+  SymbolIdent* result = NULL;
+  if (!yyparse(parser->scanner, &result))
+    return result;
   else //Parsing failed for whatever reason
     return NULL;
 }
 
-%}
+/**
+ * Allocates zeroed memory for the parse tree, counting the bytes in the runtime statistics
+ */
+void* parserAlloc(size_t size) {
+  statsAdd(StatCounter_PARSER_BYTES, size);
+  return calloc(1, size);
+}
+
+/**
+ * Counts a list node built by the parser in the runtime statistics
+ */
+ValList* parserListNode(Val value, ValList* next) {
+  statsAdd(StatCounter_PARSER_CELLS, 1);
+  statsAdd(StatCounter_PARSER_BYTES, sizeof(ValList));
+  return createListNode(value, next);
+}
+
+/**
+ * Builds the vector of a vector literal from the list of its elements
+ */
+Vector* parserVector(ValList* nodes) {
+  intptr_t length = 0;
+  for (ValList* node = nodes; node; node = node->next)
+    length++;
+  statsAdd(StatCounter_PARSER_BYTES, sizeof(Vector) + sizeof(Val) * length);
+  Vector* vector = createVector(length);
+  for (intptr_t i = 0; i < length; i++, nodes = nodes->next)
+    vector->elements[i] = nodes->value;
+  return vector;
+}
+
+/**
+ * Loads the list of a load directive, the path may be quoted
+ */
+ValList* loadPath(char* path) {
+  size_t length = strlen(path);
+  if (length >= 2 && path[0] == '"' && path[length-1] == '"') {
+    path[length-1] = '\0';
+    path++;
+  }
+  return loadIntegerList(path);
+}
+
+}
+
+%define api.pure full
+%param {yyscan_t scanner}
+%parse-param {SymbolIdent** result}
 
 %union {
        char* cval;
@@ -65,7 +110,7 @@ SymbolIdent* parse(FILE* inStream, FILE* debugStream) {
 %type <cval> infix
 %token <cval> NAME PLUS MINUS MULT DIV LESSER GREATER PATH
 %token <i> NUMBER EQUAL
-%token END FUNCTION VALUE LBRACKET RBRACKET LPARENS RPARENS COLON QUIT IF THEN ELSE COMMA FILEPATH
+%token END FUNCTION VALUE LBRACKET RBRACKET LBRACE RBRACE LPARENS RPARENS COLON QUIT IF THEN ELSE COMMA FILEPATH LOAD
 %left PLUS MINUS
 %left MULT DIV
 %left EQUAL
@@ -73,28 +118,29 @@ SymbolIdent* parse(FILE* inStream, FILE* debugStream) {
 
 declaration: function COLON 
 	     {
-	       it=$1; 
-	       DPRINT("Made function\n"); 
+	       *result=$1; 
+	       TRACE1(TraceEvent_MADE_FUNCTION, 0, 0); 
 	       YYACCEPT;
 	     }
 	     | constant COLON {
-	       it=$1; 
-	       DPRINT("Made value\n"); 
+	       *result=$1; 
+	       TRACE1(TraceEvent_MADE_VALUE, 0, 0); 
 	       YYACCEPT;
 	     }
 	     | base_expr COLON {
-	       it=$1; 
-	       DPRINT("Made base expression\n"); 
+	       *result=$1; 
+	       TRACE1(TraceEvent_MADE_BASE, 0, 0); 
 	       YYACCEPT;
 	     }
-             | QUIT {it=(SymbolIdent*)(intptr_t)5; YYACCEPT;}
+             | QUIT {*result=PARSE_QUIT; YYACCEPT;}
+	     | {*result=PARSE_QUIT; YYACCEPT;}
 	     | FILEPATH PATH COLON
 	     {
-	       yyin=fopen($2,"r");
-	       if (yyin == NULL) {
+	       FILE* included=fopen($2,"r");
+	       if (included == NULL)
 		 printf("Invalid file name or path\n");
-		 yyin = stdin;
-	       }
+	       else
+		 parserInclude(yyget_extra(scanner), included);
 	       YYABORT;	 
 	     }
             | error COLON {printf("Syntax error\n"); YYABORT;}
@@ -103,44 +149,50 @@ declaration: function COLON
 
 function: FUNCTION NAME LPARENS arguments RPARENS EQUAL expression
 	  {
-	    SymbolIdent* returnPointer = malloc(sizeof(SymbolIdent));
+	    SymbolIdent* returnPointer = parserAlloc(sizeof(SymbolIdent));
 	    returnPointer->name = strdup($2);
 	    returnPointer->argNames = $4;
 	    returnPointer->parseTree = $7;
+	    returnPointer->calls = 0;
+	    returnPointer->native = NULL;
 	    $$ = returnPointer;
 	  }
 	  ;
 
 constant: VALUE NAME EQUAL expression
 	  {
-	    SymbolIdent* returnPointer = malloc(sizeof(SymbolIdent));
+	    SymbolIdent* returnPointer = parserAlloc(sizeof(SymbolIdent));
 	    returnPointer->name = strdup($2);
 	    returnPointer->argNames = NULL;
 	    returnPointer->parseTree = $4;
+	    returnPointer->calls = 0;
+	    returnPointer->native = NULL;
 	    $$ = returnPointer;
 	  }
 	  ;
 
 base_expr: expression
 	   {
-	    SymbolIdent* returnPointer = malloc(sizeof(SymbolIdent));
+	    SymbolIdent* returnPointer = parserAlloc(sizeof(SymbolIdent));
 	    returnPointer->name = NULL;
 	    returnPointer->argNames = NULL;
 	    returnPointer->parseTree = $1;
+	    returnPointer->calls = 0;
+	    returnPointer->native = NULL;
 	    $$ = returnPointer;
 	   }
 
 arguments:		     {$$ = NULL;}
 	 | argument
 	 {
-	    NameListNode* returnPointer = malloc(sizeof(NameListNode));
+	    NameListNode* returnPointer = parserAlloc(sizeof(NameListNode));
 	    returnPointer->name = $1;
 	    returnPointer->next = NULL;
 	    $$ = returnPointer;
 	 }
 	 | argument COMMA arguments
 	 {
-	    NameListNode* returnPointer = malloc(sizeof(NameListNode));
+	    NameListNode* returnPointer = parserAlloc(sizeof(NameListNode));
 	    returnPointer->name = $1;
 	    returnPointer->next = $3;
 	    $$ = returnPointer;
@@ -153,14 +205,14 @@ argument: NAME		{$$ = strdup($1);}
 expressionlist:		{$$=NULL;}
 	      | expression
 	      {
-		PointerListNode* returnPointer = malloc(sizeof(PointerListNode));
+		PointerListNode* returnPointer = parserAlloc(sizeof(PointerListNode));
 		returnPointer->next = NULL;
 		returnPointer->target = $1;
 		$$ = returnPointer;
 	      }
 	      | expression COMMA expressionlist
 	      {
-		PointerListNode* returnPointer = malloc(sizeof(PointerListNode));
+		PointerListNode* returnPointer = parserAlloc(sizeof(PointerListNode));
 		returnPointer->next = $3;
 		returnPointer->target = $1;
 		$$ = returnPointer;
@@ -169,9 +221,9 @@ expressionlist:		{$$=NULL;}
 
 expression: expression infix term
 	    {
-		TreeNode* returnPointer = malloc(sizeof(TreeNode));
-		PointerListNode* arg1 = malloc(sizeof(PointerListNode));
-		PointerListNode* arg2 = malloc(sizeof(PointerListNode));
+		TreeNode* returnPointer = parserAlloc(sizeof(TreeNode));
+		PointerListNode* arg1 = parserAlloc(sizeof(PointerListNode));
+		PointerListNode* arg2 = parserAlloc(sizeof(PointerListNode));
 		arg1->target=$1;
 		arg2->target=$3;
 		arg1->next=arg2;
@@ -180,14 +232,14 @@ expression: expression infix term
 		returnPointer->value = 
 		createVal(ValueType_FUNCTION, (intptr_t) $2);
 		$$ = returnPointer;
-		DPRINT("Made expression infix function call to %s\n", $2);
+		TRACE1(TraceEvent_MADE_INFIX, $2, 0);
 	    }
 	  | IF expression THEN expression ELSE expression
 	    {
-		TreeNode* returnPointer = malloc(sizeof(TreeNode));
-		PointerListNode* arg1 = malloc(sizeof(PointerListNode));
-		PointerListNode* arg2 = malloc(sizeof(PointerListNode));
-		PointerListNode* arg3 = malloc(sizeof(PointerListNode));
+		TreeNode* returnPointer = parserAlloc(sizeof(TreeNode));
+		PointerListNode* arg1 = parserAlloc(sizeof(PointerListNode));
+		PointerListNode* arg2 = parserAlloc(sizeof(PointerListNode));
+		PointerListNode* arg3 = parserAlloc(sizeof(PointerListNode));
 		arg1->target=$2;
 		arg2->target=$4;
 		arg3->target=$6;
@@ -198,7 +250,7 @@ expression: expression infix term
 		returnPointer->value = 
 		createVal(ValueType_FUNCTION, (intptr_t) strdup("ite"));
 		$$ = returnPointer;
-		DPRINT("Made if-then-else expression\n");
+		TRACE1(TraceEvent_MADE_ITE, 0, 0);
 	    }
 	  | term {$$ = $1;}
 
@@ -207,29 +259,29 @@ expression: expression infix term
 
 term:	    NAME LPARENS expressionlist RPARENS 
 	    {
-		TreeNode* returnPointer = malloc(sizeof(TreeNode));
+		TreeNode* returnPointer = parserAlloc(sizeof(TreeNode));
 		returnPointer->argList = $3;
 		returnPointer->value = 
 		createVal(ValueType_FUNCTION, (intptr_t) $1);
 		$$ = returnPointer;
-		DPRINT("Made expression function call\n");
+		TRACE1(TraceEvent_MADE_CALL, 0, 0);
 	    }
 	  | NAME
 	    {		
-	    	TreeNode* returnPointer = malloc(sizeof(TreeNode));
+	    	TreeNode* returnPointer = parserAlloc(sizeof(TreeNode));
 		returnPointer->argList = NULL;
 		returnPointer->value = 
 		createVal(ValueType_CONSTANT, (intptr_t) $1);
 		$$ = returnPointer;
-		DPRINT("Made expression symbol reference to %s\n",$1);
+		TRACE1(TraceEvent_MADE_REFERENCE, $1, 0);
 	    }
           | value
 	    {
-		TreeNode* returnPointer = malloc(sizeof(TreeNode));
+		TreeNode* returnPointer = parserAlloc(sizeof(TreeNode));
 		returnPointer->argList = NULL;
 		returnPointer->value = $1;
 		$$ = returnPointer;
-		DPRINT("Made expression constant value\n");
+		TRACE1(TraceEvent_MADE_CONSTANT, 0, 0);
 	    }
 	  | LPARENS expression RPARENS {$$ = $2;}	    	  
 	    ;
@@ -244,15 +296,24 @@ infix:	       PLUS	{$$ = $1;}
 
 value: list 		{
        			 $$=createVal(ValueType_LIST,(intptr_t) $1);
-       			 DPRINT("Made list\n");
+       			 TRACE1(TraceEvent_MADE_LIST, 0, 0);
+			}
+     |  LBRACE nodes RBRACE {
+			 $$=createVal(ValueType_VECTOR,(intptr_t) parserVector($2));
+			 TRACE1(TraceEvent_MADE_VECTOR, 0, 0);
 			}
      |  MINUS NUMBER 	{
      	      		 $$=createVal(ValueType_INT,-((intptr_t) $2));
-			 DPRINT("Made negative number\n");
+			 TRACE1(TraceEvent_MADE_NEGATIVE, 0, 0);
 			}
      |  NUMBER 		{
 			 $$=createVal(ValueType_INT,(intptr_t) $1);
-			 DPRINT("Made number\n");
+			 TRACE1(TraceEvent_MADE_NUMBER, 0, 0);
+			}
+     |  LOAD LPARENS PATH RPARENS {
+			 $$=createVal(ValueType_LIST,(intptr_t) loadPath($3));
+			 free($3);
+			 TRACE1(TraceEvent_MADE_LOADED, 0, 0);
 			}
      ;
 
@@ -263,16 +324,10 @@ list: LBRACKET nodes RBRACKET {$$=$2;}
 nodes:	       	     	{$$=NULL;}
      | value		
      {
-       	ValList* returnVal = malloc(sizeof(ValList));
-	returnVal->value=$1;
-	returnVal->next=NULL;
-	 $$=returnVal;
+	 $$=parserListNode($1,NULL);
      }
      | value COMMA nodes
      {
-	ValList* returnVal = malloc(sizeof(ValList));
-	returnVal->value=$1;
-	returnVal->next=$3;
-	$$=returnVal;
+	$$=parserListNode($1,$3);
      }
      ;
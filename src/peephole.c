@@ -0,0 +1,77 @@
+/**
+ * @brief: This is the file containing the fused idioms.
+ * A node is examined the first time it is evaluated. Comparisons of the length of a list with an int constant count at most one node more than the constant, since the comparison turns out the same for every longer list, and hd(tl(l)) skips the dispatch and argument setup of the inner call
+ * @file: peephole.c
+ * @date: 19/10 2026
+ */
+#include "peephole.h"
+#include "trace.h"
+#include <string.h>
+
+/**
+ * Examines whether a node calls a builtin of one argument
+ */
+static int callsUnary(TreeNode* node, const char* name) {
+  return getType(node->value) == ValueType_FUNCTION && !strcmp(getCharVal(node->value), name) &&
+    node->argList && !node->argList->next;
+}
+
+/**
+ * Examines whether a node is an int constant
+ */
+static int isNumber(TreeNode* node) {
+  return getType(node->value) == ValueType_INT && !node->argList;
+}
+
+Idiom findIdiom(TreeNode* node) {
+  if (getType(node->value) != ValueType_FUNCTION || !node->argList)
+    return Idiom_NONE;
+  char* name = getCharVal(node->value);
+  PointerListNode* children = node->argList;
+  if (children->next && !children->next->next &&
+      (!strcmp(name, "equals") || !strcmp(name, "lesser") || !strcmp(name, "greater")) &&
+      ((callsUnary(children->target, "length") && isNumber(children->next->target)) ||
+       (isNumber(children->target) && callsUnary(children->next->target, "length"))))
+    return Idiom_LENGTH_COMPARE;
+  if (callsUnary(node, "hd") && callsUnary(children->target, "tl"))
+    return Idiom_SECOND;
+  return Idiom_NONE;
+}
+
+/**
+ * Counts the nodes of a list, stopping at a limit
+ * @return: the length of the list, or the limit if the list is at least that long
+ */
+static intptr_t countUpTo(Val list, intptr_t limit) {
+  intptr_t count = 0;
+  for (ValList* node = getListVal(list); node; node = getNextNode(node)) {
+    if (++count >= limit)
+      return limit;
+    //A lazy list may know its length without being forced
+    if (node->rest && node->rest->state != ThunkState_DONE && node->rest->length >= 0)
+      return count + node->rest->length < limit ? count + node->rest->length : limit;
+  }
+  return count;
+}
+
+Val evalIdiom(TreeNode* node, ArgName args[], int argNum) {
+  TRACE2(TraceEvent_IDIOM, 0, 0);
+  PointerListNode* children = node->argList;
+  if (node->idiom == Idiom_SECOND)
+    return evalHead(evalTail(eval(children->target->argList->target, args, argNum)));
+  //The length is compared as the length up to one more than the constant, which compares the same
+  int lengthFirst = !isNumber(children->target);
+  TreeNode* length = lengthFirst ? children->target : children->next->target;
+  Val bound = lengthFirst ? children->next->target->value : children->target->value;
+  Val list = eval(length->argList->target, args, argNum);
+  //Anything but a list is measured the way the length node would measure it
+  Val count = getType(list) == ValueType_LIST ? createVal(ValueType_INT, countUpTo(list, getIntVal(bound) + 1)) : evalLength(list);
+  Val first = lengthFirst ? count : bound;
+  Val second = lengthFirst ? bound : count;
+  char* name = getCharVal(node->value);
+  if (!strcmp(name, "equals"))
+    return evalEqual(first, second);
+  if (!strcmp(name, "lesser"))
+    return evalLesser(first, second);
+  return evalLesser(second, first);
+}
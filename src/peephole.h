@@ -0,0 +1,33 @@
+/**
+ * @brief: Header for fused idioms, where a few nodes that often appear together are evaluated as one
+ * @file: peephole.h
+ * @date: 19/10 2026
+ */
+
+#ifndef PEEPHOLE_HEADER
+#define PEEPHOLE_HEADER
+#include "eval.h"
+
+/**
+ * Defines the idioms a node can be evaluated as, stored in the idiom field of the node
+ */
+typedef enum Idiom {
+  Idiom_NONE = -1, /** The node is evaluated as usual */
+  Idiom_UNEXAMINED = 0, /** The node has not been evaluated yet */
+  Idiom_LENGTH_COMPARE, /** length(l) compared to an int constant by =, < or >, which only walks the list as far as the comparison needs, so length(l) > 0 only tests whether l is empty */
+  Idiom_SECOND /** hd(tl(l)) */
+} Idiom;
+
+/**
+ * Finds the idiom a node can be evaluated as. The builtins can not be redefined, so the idiom of a node never changes
+ * @return: the Idiom, Idiom_NONE if there is none
+ */
+Idiom findIdiom(TreeNode* node);
+/**
+ * Evaluates a node as the idiom found for it, giving the same value as evaluating its nodes one by one whenever that terminates. A length comparison stops counting a list one node past the constant, so it also terminates on an unbounded list
+ * @param: The node, the local symbol bindings and their number
+ * @return: The value of the node
+ */
+Val evalIdiom(TreeNode* node, ArgName args[], int argNum);
+
+#endif
@@ -0,0 +1,383 @@
+/**
+ * @brief: This is the file containing the implementation of the profiler.
+ * Every thread keeps its own call tree and per-function table, so that recording a call takes no locks. The threads are only merged when the profile is written.
+ * Direct recursion is folded into one node of the call tree, so that deep recursion does not produce equally deep stacks.
+ * @file: profile.c
+ * @date: 19/10 2026
+ */
+#include "profile.h"
+#include "hashmap.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define INITIAL_FRAMES 64
+#define INITIAL_STATS 64
+
+int profiling = 0;
+
+/**
+ * Defines the measurements of one function.
+ */
+typedef struct {
+  SymbolIdent* symbol; /** The function, NULL for unused slots */
+  long calls; /** The number of calls */
+  long forks; /** The number of threads forked by the function itself */
+  long conses; /** The number of cons cells allocated by the function itself */
+  int64_t inclusive; /** Nanoseconds spent in outermost calls, including the functions they call */
+  int64_t exclusive; /** Nanoseconds spent in the function itself */
+  int active; /** The number of calls of the function in progress on the thread */
+} ProfileStat;
+
+/**
+ * Defines a node in the call tree of a thread.
+ */
+typedef struct ProfileNode {
+  SymbolIdent* symbol; /** The function called */
+  struct ProfileNode* parent; /** The caller, NULL for calls made outside any function */
+  struct ProfileNode* child; /** The first function called from here */
+  struct ProfileNode* sibling; /** The next function called from the caller */
+  int64_t exclusive; /** Nanoseconds spent in the function itself at this position */
+} ProfileNode;
+
+/**
+ * Defines a call in progress.
+ */
+typedef struct {
+  ProfileNode* node; /** The position of the call */
+  ProfileStat* stat; /** The measurements of the function called */
+  int64_t start; /** When the call started */
+  int64_t children; /** Nanoseconds spent in calls made from this one */
+} ProfileFrame;
+
+/**
+ * Defines the measurements of one thread.
+ */
+typedef struct ProfileThread {
+  ProfileNode root; /** The parent of calls made outside any function */
+  ProfileNode* origin; /** The position in the forking thread where this thread was forked */
+  ProfileFrame* frames; /** The calls in progress */
+  int frameNum; /** The number of calls in progress */
+  int frameCapacity; /** The number of frames there is room for */
+  ProfileStat* stats; /** The open-addressed table of functions */
+  int statNum; /** The number of functions in stats */
+  int statCapacity; /** The size of stats, always a power of two */
+  struct ProfileThread* next; /** The next thread in the list of all threads */
+} ProfileThread;
+
+static __thread ProfileThread* profileThread = NULL;
+static ProfileThread* allThreads = NULL;
+static pthread_mutex_t threadsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Obtains the current time
+ * @return: a monotonic time in nanoseconds
+ */
+static int64_t profileNow() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (int64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/**
+ * Obtains the measurements of the current thread, creating them on first use
+ */
+static ProfileThread* currentThread() {
+  if (!profileThread) {
+    ProfileThread* thread = calloc(1, sizeof(ProfileThread));
+    thread->frameCapacity = INITIAL_FRAMES;
+    thread->frames = malloc(sizeof(ProfileFrame) * thread->frameCapacity);
+    thread->statCapacity = INITIAL_STATS;
+    thread->stats = calloc(thread->statCapacity, sizeof(ProfileStat));
+    pthread_mutex_lock(&threadsLock);
+    thread->next = allThreads;
+    allThreads = thread;
+    pthread_mutex_unlock(&threadsLock);
+    profileThread = thread;
+  }
+  return profileThread;
+}
+
+/**
+ * Finds the slot of a function in a table
+ * @return: the slot holding the function, or the empty slot where it belongs
+ */
+static ProfileStat* findStat(ProfileStat* stats, int capacity, SymbolIdent* symbol) {
+  unsigned index = (unsigned) (((uintptr_t) symbol >> 4) * 2654435761u) & (capacity - 1);
+  while (stats[index].symbol && stats[index].symbol != symbol)
+    index = (index + 1) & (capacity - 1);
+  return &stats[index];
+}
+
+/**
+ * Obtains the measurements of a function on a thread, adding the function if it is new
+ */
+static ProfileStat* threadStat(ProfileThread* thread, SymbolIdent* symbol) {
+  ProfileStat* stat = findStat(thread->stats, thread->statCapacity, symbol);
+  if (stat->symbol)
+    return stat;
+  if (2 * (thread->statNum + 1) > thread->statCapacity) {
+    //Frames point into the table, so they have to follow it
+    ProfileStat* old = thread->stats;
+    int oldCapacity = thread->statCapacity;
+    thread->statCapacity *= 2;
+    thread->stats = calloc(thread->statCapacity, sizeof(ProfileStat));
+    for (int i = 0; i < oldCapacity; i++)
+      if (old[i].symbol)
+	*findStat(thread->stats, thread->statCapacity, old[i].symbol) = old[i];
+    for (int i = 0; i < thread->frameNum; i++)
+      thread->frames[i].stat = findStat(thread->stats, thread->statCapacity, thread->frames[i].stat->symbol);
+    free(old);
+    stat = findStat(thread->stats, thread->statCapacity, symbol);
+  }
+  stat->symbol = symbol;
+  thread->statNum++;
+  return stat;
+}
+
+/**
+ * Obtains the node of a call made from a position, adding it if the call is new there. Calls of the function at the position itself fold into it
+ */
+static ProfileNode* childNode(ProfileNode* parent, SymbolIdent* symbol) {
+  if (parent->symbol == symbol)
+    return parent;
+  ProfileNode* child = parent->child;
+  while (child && child->symbol != symbol)
+    child = child->sibling;
+  if (!child) {
+    child = calloc(1, sizeof(ProfileNode));
+    child->symbol = symbol;
+    child->parent = parent;
+    child->sibling = parent->child;
+    parent->child = child;
+  }
+  return child;
+}
+
+/**
+ * Marks the start of a call of a user-defined function on the current thread
+ */
+void profileEnter(SymbolIdent* symbol) {
+  ProfileThread* thread = currentThread();
+  if (thread->frameNum == thread->frameCapacity) {
+    thread->frameCapacity *= 2;
+    thread->frames = realloc(thread->frames, sizeof(ProfileFrame) * thread->frameCapacity);
+  }
+  ProfileNode* parent = thread->frameNum ? thread->frames[thread->frameNum-1].node : &thread->root;
+  ProfileFrame* frame = &thread->frames[thread->frameNum++];
+  frame->node = childNode(parent, symbol);
+  frame->stat = threadStat(thread, symbol);
+  frame->stat->calls++;
+  frame->stat->active++;
+  frame->children = 0;
+  frame->start = profileNow();
+}
+
+/**
+ * Marks the end of the innermost call started on the current thread
+ */
+void profileExit() {
+  ProfileThread* thread = profileThread;
+  if (!thread || !thread->frameNum)
+    return;
+  ProfileFrame* frame = &thread->frames[--thread->frameNum];
+  int64_t elapsed = profileNow() - frame->start;
+  frame->stat->exclusive += elapsed - frame->children;
+  frame->node->exclusive += elapsed - frame->children;
+  if (!--frame->stat->active)
+    frame->stat->inclusive += elapsed;
+  if (thread->frameNum)
+    thread->frames[thread->frameNum-1].children += elapsed;
+}
+
+/**
+ * Counts a thread forked by the innermost call on the current thread. Outside of calls, the call that forked the thread is charged
+ */
+void profileFork() {
+  ProfileThread* thread = currentThread();
+  if (thread->frameNum)
+    thread->frames[thread->frameNum-1].stat->forks++;
+  else if (thread->origin)
+    threadStat(thread, thread->origin->symbol)->forks++;
+}
+
+/**
+ * Counts a cons cell allocated by the innermost call on the current thread. Outside of calls, the call that forked the thread is charged
+ */
+void profileCons() {
+  ProfileThread* thread = currentThread();
+  if (thread->frameNum)
+    thread->frames[thread->frameNum-1].stat->conses++;
+  else if (thread->origin)
+    threadStat(thread, thread->origin->symbol)->conses++;
+}
+
+/**
+ * Obtains the position in the call tree of the current thread, to be handed to the threads it forks
+ * @return: an opaque pointer to the position, or NULL outside of calls
+ */
+void* profilePosition() {
+  ProfileThread* thread = currentThread();
+  if (thread->frameNum)
+    return thread->frames[thread->frameNum-1].node;
+  return thread->origin;
+}
+
+/**
+ * Starts profiling a new thread whose calls are made below a position of the thread that forked it
+ */
+void profileStartThread(void* origin) {
+  currentThread()->origin = (ProfileNode*) origin;
+}
+
+/**
+ * Defines a collapsed stack while the profile is merged.
+ */
+typedef struct {
+  char* stack; /** The names of the functions from the outermost call, separated by ; */
+  int64_t exclusive; /** The nanoseconds spent at the stack */
+} FoldedStack;
+
+/**
+ * Defines the state of writing the collapsed stacks.
+ */
+typedef struct {
+  map_t stacks; /** The FoldedStack of every stack seen so far, by stack */
+  FoldedStack** order; /** The stacks in the order they were first seen */
+  int num; /** The number of stacks */
+  int capacity; /** The number of stacks there is room for in order */
+} FoldedStacks;
+
+/**
+ * Writes the path from the outermost call to a node, following the origins of forked threads
+ * @return: the length of the path
+ */
+static size_t stackName(ProfileNode* node, ProfileNode* origin, char* buffer, size_t size) {
+  size_t length = 0;
+  if (node->parent)
+    length = stackName(node->parent, origin, buffer, size);
+  else if (origin)
+    return stackName(origin, NULL, buffer, size);
+  else
+    return 0;
+  const char* name = node->symbol->name ? node->symbol->name : "?";
+  size_t nameLength = strlen(name);
+  if (length + nameLength + 2 < size) {
+    if (length)
+      buffer[length++] = ';';
+    memcpy(buffer + length, name, nameLength);
+    length += nameLength;
+    buffer[length] = '\0';
+  }
+  return length;
+}
+
+/**
+ * Adds the exclusive time of every node below a node to the collapsed stacks
+ */
+static void foldNodes(FoldedStacks* folded, ProfileNode* node, ProfileNode* origin) {
+  for (ProfileNode* child = node->child; child; child = child->sibling) {
+    if (child->exclusive > 0) {
+      char buffer[4096];
+      buffer[0] = '\0';
+      stackName(child, origin, buffer, sizeof(buffer));
+      FoldedStack* stack;
+      if (hashmap_get(folded->stacks, buffer, (any_t*) &stack) != MAP_OK) {
+	stack = malloc(sizeof(FoldedStack));
+	stack->stack = strdup(buffer);
+	stack->exclusive = 0;
+	hashmap_put(folded->stacks, stack->stack, stack);
+	if (folded->num == folded->capacity) {
+	  folded->capacity = folded->capacity ? folded->capacity * 2 : 64;
+	  folded->order = realloc(folded->order, sizeof(FoldedStack*) * folded->capacity);
+	}
+	folded->order[folded->num++] = stack;
+      }
+      stack->exclusive += child->exclusive;
+    }
+    foldNodes(folded, child, origin);
+  }
+}
+
+/**
+ * Orders functions by descending exclusive time
+ */
+static int compareStats(const void* a, const void* b) {
+  int64_t difference = ((const ProfileStat*) b)->exclusive - ((const ProfileStat*) a)->exclusive;
+  return difference > 0 ? 1 : (difference < 0 ? -1 : 0);
+}
+
+/**
+ * Merges the measurements of all threads and writes them.
+ */
+void writeProfile(const char* path) {
+  pthread_mutex_lock(&threadsLock);
+  int capacity = INITIAL_STATS;
+  int num = 0;
+  ProfileStat* merged = calloc(capacity, sizeof(ProfileStat));
+  FoldedStacks folded = {hashmap_new(), NULL, 0, 0};
+  for (ProfileThread* thread = allThreads; thread; thread = thread->next) {
+    for (int i = 0; i < thread->statCapacity; i++) {
+      ProfileStat* stat = &thread->stats[i];
+      if (!stat->symbol)
+	continue;
+      if (2 * (num + 1) > capacity) {
+	ProfileStat* old = merged;
+	capacity *= 2;
+	merged = calloc(capacity, sizeof(ProfileStat));
+	for (int j = 0; j < capacity / 2; j++)
+	  if (old[j].symbol)
+	    *findStat(merged, capacity, old[j].symbol) = old[j];
+	free(old);
+      }
+      ProfileStat* total = findStat(merged, capacity, stat->symbol);
+      if (!total->symbol) {
+	total->symbol = stat->symbol;
+	num++;
+      }
+      total->calls += stat->calls;
+      total->forks += stat->forks;
+      total->conses += stat->conses;
+      total->inclusive += stat->inclusive;
+      total->exclusive += stat->exclusive;
+    }
+    foldNodes(&folded, &thread->root, thread->origin);
+  }
+  pthread_mutex_unlock(&threadsLock);
+
+  //Pack the table so it can be sorted
+  int packed = 0;
+  for (int i = 0; i < capacity; i++)
+    if (merged[i].symbol)
+      merged[packed++] = merged[i];
+  qsort(merged, packed, sizeof(ProfileStat), compareStats);
+
+  FILE* out = fopen(path, "w");
+  if (!out) {
+    printf("Failed to open profile file %s\n", path);
+  }
+  else {
+    fprintf(out, "%-24s %12s %16s %16s %10s %12s\n", "function", "calls", "inclusive_ns", "exclusive_ns", "forks", "conses");
+    for (int i = 0; i < packed; i++)
+      fprintf(out, "%-24s %12ld %16lld %16lld %10ld %12ld\n", merged[i].symbol->name, merged[i].calls,
+	      (long long) merged[i].inclusive, (long long) merged[i].exclusive, merged[i].forks, merged[i].conses);
+    fclose(out);
+  }
+
+  char* foldedPath = malloc(strlen(path) + 8);
+  sprintf(foldedPath, "%s.folded", path);
+  out = fopen(foldedPath, "w");
+  if (!out) {
+    printf("Failed to open profile file %s\n", foldedPath);
+  }
+  else {
+    for (int i = 0; i < folded.num; i++)
+      fprintf(out, "%s %lld\n", folded.order[i]->stack, (long long) folded.order[i]->exclusive);
+    fclose(out);
+  }
+  free(foldedPath);
+  free(merged);
+}
@@ -0,0 +1,44 @@
+/**
+ * @brief: Header for the profiler, which measures the calls of user-defined functions per thread and reports them per function and as collapsed stacks
+ * @file: profile.h
+ * @date: 19/10 2026
+ */
+
+#ifndef PROFILE_HEADER
+#define PROFILE_HEADER
+#include "structures.h"
+
+extern int profiling; /** Nonzero if calls are profiled, set before any evaluation */
+
+/**
+ * Marks the start of a call of a user-defined function on the current thread
+ */
+void profileEnter(SymbolIdent* symbol);
+/**
+ * Marks the end of the innermost call started on the current thread
+ */
+void profileExit();
+/**
+ * Counts a thread forked by the innermost call on the current thread
+ */
+void profileFork();
+/**
+ * Counts a cons cell allocated by the innermost call on the current thread
+ */
+void profileCons();
+/**
+ * Obtains the position in the call tree of the current thread, to be handed to the threads it forks
+ * @return: an opaque pointer to the position, or NULL outside of calls
+ */
+void* profilePosition();
+/**
+ * Starts profiling a new thread whose calls are made below a position of the thread that forked it
+ */
+void profileStartThread(void* origin);
+/**
+ * Merges the measurements of all threads and writes them.
+ * The report, sorted by exclusive time, is written to path, and the collapsed stacks, weighted by exclusive nanoseconds, to path.folded
+ */
+void writeProfile(const char* path);
+
+#endif
@@ -0,0 +1,329 @@
+/**
+ * @brief: This is the file containing the server mode.
+ * The main thread accepts connections and reads lines from all of them with poll, numbering the lines of every connection. The lines are queued for a pool of workers, which evaluate them in any order and hand the answers back to their connection, where they are written in the order of the numbers.
+ * Expressions are evaluated concurrently by the workers. Definitions are queued like expressions, and a worker makes one only once every line queued before it has been answered, while the lines queued after it wait. So a line sees exactly the definitions sent before it, whichever connection sent them
+ * @file: server.c
+ * @date: 19/10 2026
+ */
+#undef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700 //for open_memstream
+#include "server.h"
+#include "output.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * Defines an answer that waits for the answers before it to be written.
+ */
+typedef struct Answer {
+  long number; /** The number of the line answered */
+  char* text; /** The answer, ending in a newline */
+  size_t length; /** The length of text */
+  struct Answer* next; /** The next waiting answer */
+} Answer;
+
+/**
+ * Defines a client connection.
+ */
+typedef struct Connection {
+  int fd; /** The socket */
+  char* buffer; /** The characters read that do not yet form a whole line */
+  size_t length; /** The number of characters in buffer */
+  size_t capacity; /** The size of buffer */
+  long sent; /** The number of lines queued */
+  long written; /** The number of answers written */
+  int closed; /** Nonzero once the client has stopped sending */
+  Answer* waiting; /** The answers that arrived before the answers they follow */
+  pthread_mutex_t lock; /** Guards written, closed and waiting */
+} Connection;
+
+/**
+ * Defines a line waiting for a worker.
+ */
+typedef struct Request {
+  Connection* connection; /** Where the answer goes */
+  long number; /** The number of the line on its connection */
+  char* line; /** The line, ending in ; */
+  int definition; /** Nonzero if the line is a definition */
+  struct Request* next; /** The next request in the queue */
+} Request;
+
+static Interpreter* served;
+static Request* queueHead = NULL;
+static Request* queueTail = NULL;
+static int running = 0; /** The number of requests taken by workers and not yet answered */
+static int defining = 0; /** Nonzero while a worker makes a definition */
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueReady = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Writes all of a buffer to a socket
+ */
+static void writeAll(int fd, const char* text, size_t length) {
+  while (length) {
+    ssize_t done = write(fd, text, length);
+    if (done <= 0 && errno != EINTR)
+      return;
+    if (done > 0) {
+      text += done;
+      length -= done;
+    }
+  }
+}
+
+/**
+ * Frees a connection whose client has stopped sending and whose answers are all written, must be called with the lock held
+ * @return: 1 if the connection was freed
+ */
+static int finishConnection(Connection* connection) {
+  if (!connection->closed || connection->written < connection->sent)
+    return 0;
+  pthread_mutex_unlock(&connection->lock);
+  close(connection->fd);
+  pthread_mutex_destroy(&connection->lock);
+  free(connection->buffer);
+  free(connection);
+  return 1;
+}
+
+/**
+ * Hands an answer to its connection, writing it and every waiting answer that follows it once all earlier answers are written
+ */
+static void answer(Connection* connection, long number, char* text, size_t length) {
+  Answer* current = malloc(sizeof(Answer));
+  current->number = number;
+  current->text = text;
+  current->length = length;
+  pthread_mutex_lock(&connection->lock);
+  current->next = connection->waiting;
+  connection->waiting = current;
+  int progress = 1;
+  while (progress) {
+    progress = 0;
+    for (Answer** link = &connection->waiting; *link; link = &(*link)->next) {
+      if ((*link)->number == connection->written) {
+	Answer* next = *link;
+	*link = next->next;
+	writeAll(connection->fd, next->text, next->length);
+	free(next->text);
+	free(next);
+	connection->written++;
+	progress = 1;
+	break;
+      }
+    }
+  }
+  if (!finishConnection(connection))
+    pthread_mutex_unlock(&connection->lock);
+}
+
+/**
+ * Examines whether a line is a definition
+ * @return: 1 if the line starts with fun or val, 0 otherwise
+ */
+static int isDefinition(const char* line) {
+  while (*line == ' ' || *line == '\t')
+    line++;
+  return (!strncmp(line, "fun", 3) || !strncmp(line, "val", 3)) && (line[3] == ' ' || line[3] == '\t');
+}
+
+/**
+ * Evaluates or defines the line of a request
+ * @return: the answer, ending in a newline
+ */
+static char* evaluate(Request* request, size_t* length) {
+  char* text = NULL;
+  FILE* out = open_memstream(&text, length);
+  Val result;
+  InterpreterStatus status;
+  if (request->definition) {
+    status = interpreterDefine(served, request->line);
+    if (status == InterpreterStatus_OK)
+      fprintf(out, "defined\n");
+  }
+  else {
+    status = interpreterEval(served, request->line, &result);
+    if (status == InterpreterStatus_OK) {
+      writeVal(out, result, OutputMode_TEXT);
+      fputc('\n', out);
+    }
+  }
+  if (status == InterpreterStatus_NOT_EXPRESSION || status == InterpreterStatus_NOT_DEFINITION)
+    fprintf(out, "error: not a single declaration\n");
+  else if (status == InterpreterStatus_SYNTAX_ERROR)
+    fprintf(out, "error: syntax error\n");
+  else if (status == InterpreterStatus_REDEFINITION)
+    fprintf(out, "error: redefinition is not allowed\n");
+  else if (status == InterpreterStatus_EMPTY)
+    fprintf(out, "error: empty line\n");
+  fclose(out);
+  return text;
+}
+
+/**
+ * The loop of a worker, evaluates queued lines forever. A definition is taken only when no other request is running, and nothing is taken while it is made, so the symbols never change under an evaluation
+ * @return: Never returns
+ */
+static void* work(void* unused) {
+  while (1) {
+    pthread_mutex_lock(&queueLock);
+    while (!queueHead || defining || (queueHead->definition && running))
+      pthread_cond_wait(&queueReady, &queueLock);
+    Request* request = queueHead;
+    queueHead = request->next;
+    if (!queueHead)
+      queueTail = NULL;
+    running++;
+    defining = request->definition;
+    pthread_mutex_unlock(&queueLock);
+    size_t length;
+    char* text = evaluate(request, &length);
+    answer(request->connection, request->number, text, length);
+    pthread_mutex_lock(&queueLock);
+    running--;
+    //The requests queued after a definition wait for it, and a definition waits for the last request running
+    if (defining || (!running && queueHead && queueHead->definition))
+      pthread_cond_broadcast(&queueReady);
+    defining = 0;
+    pthread_mutex_unlock(&queueLock);
+    free(request->line);
+    free(request);
+  }
+  return 0;
+}
+
+/**
+ * Queues a line of a connection for the workers, adding the ; that ends a declaration if it is missing
+ */
+static void enqueue(Connection* connection, const char* line, size_t length) {
+  while (length && (line[length-1] == '\r' || line[length-1] == ' '))
+    length--;
+  Request* request = malloc(sizeof(Request));
+  request->connection = connection;
+  request->line = malloc(length + 2);
+  memcpy(request->line, line, length);
+  if (!length || line[length-1] != ';')
+    request->line[length++] = ';';
+  request->line[length] = '\0';
+  request->definition = isDefinition(request->line);
+  request->next = NULL;
+  pthread_mutex_lock(&connection->lock);
+  request->number = connection->sent++;
+  pthread_mutex_unlock(&connection->lock);
+  pthread_mutex_lock(&queueLock);
+  if (queueTail)
+    queueTail->next = request;
+  else
+    queueHead = request;
+  queueTail = request;
+  pthread_cond_signal(&queueReady);
+  pthread_mutex_unlock(&queueLock);
+}
+
+/**
+ * Reads what a client has sent and queues every whole line
+ * @return: 0 once the client has stopped sending, 1 otherwise
+ */
+static int readConnection(Connection* connection) {
+  if (connection->capacity - connection->length < 4096) {
+    connection->capacity = 2 * connection->capacity + 4096;
+    connection->buffer = realloc(connection->buffer, connection->capacity);
+  }
+  ssize_t got = read(connection->fd, connection->buffer + connection->length, connection->capacity - connection->length);
+  if (got < 0 && errno == EINTR)
+    return 1;
+  if (got <= 0)
+    return 0;
+  connection->length += got;
+  size_t start = 0;
+  for (size_t i = connection->length - got; i < connection->length; i++) {
+    if (connection->buffer[i] == '\n') {
+      if (i > start)
+	enqueue(connection, connection->buffer + start, i - start);
+      start = i + 1;
+    }
+  }
+  memmove(connection->buffer, connection->buffer + start, connection->length - start);
+  connection->length -= start;
+  return 1;
+}
+
+/**
+ * Serves an interpreter on a Unix domain socket until the process is killed
+ */
+int runServer(Interpreter* interpreter, const char* path, int workers) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    printf("Socket path %s is too long\n", path);
+    return 1;
+  }
+  strcpy(address.sun_path, path);
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path);
+  if (listener < 0 || bind(listener, (struct sockaddr*) &address, sizeof(address)) || listen(listener, 128)) {
+    printf("Failed to open socket %s\n", path);
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  served = interpreter;
+  if (workers <= 0)
+    workers = sysconf(_SC_NPROCESSORS_ONLN);
+  for (int i = 0; i < workers; i++) {
+    pthread_t worker;
+    pthread_create(&worker, NULL, work, NULL);
+    pthread_detach(worker);
+  }
+  printf("Serving on %s with %d workers\n", path, workers);
+  fflush(stdout);
+
+  int capacity = 16;
+  int num = 1;
+  struct pollfd* polled = malloc(sizeof(struct pollfd) * capacity);
+  Connection** connections = malloc(sizeof(Connection*) * capacity);
+  polled[0].fd = listener;
+  polled[0].events = POLLIN;
+  while (1) {
+    if (poll(polled, num, -1) < 0)
+      continue;
+    for (int i = num - 1; i > 0; i--) {
+      if (polled[i].revents && !readConnection(connections[i])) {
+	Connection* connection = connections[i];
+	pthread_mutex_lock(&connection->lock);
+	connection->closed = 1;
+	if (!finishConnection(connection))
+	  pthread_mutex_unlock(&connection->lock);
+	num--;
+	polled[i] = polled[num];
+	connections[i] = connections[num];
+      }
+    }
+    if (polled[0].revents & POLLIN) {
+      int fd = accept(listener, NULL, NULL);
+      if (fd < 0)
+	continue;
+      if (num == capacity) {
+	capacity *= 2;
+	polled = realloc(polled, sizeof(struct pollfd) * capacity);
+	connections = realloc(connections, sizeof(Connection*) * capacity);
+      }
+      Connection* connection = calloc(1, sizeof(Connection));
+      connection->fd = fd;
+      pthread_mutex_init(&connection->lock, NULL);
+      polled[num].fd = fd;
+      polled[num].events = POLLIN;
+      polled[num].revents = 0;
+      connections[num++] = connection;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,19 @@
+/**
+ * @brief: Header for the server mode, which keeps an interpreter and a pool of workers alive and evaluates lines sent over a Unix domain socket
+ * @file: server.h
+ * @date: 19/10 2026
+ */
+
+#ifndef SERVER_HEADER
+#define SERVER_HEADER
+#include "libinterpreter.h"
+
+/**
+ * Serves an interpreter on a Unix domain socket until the process is killed.
+ * Every line a client sends is a declaration, the trailing ; may be left out. The server answers every line with one line, in the order the lines were sent: the value of an expression, "defined" for a definition, or "error: " followed by what went wrong. Clients may send many lines without waiting for the answers
+ * @param: The interpreter, the path of the socket, and the number of workers, 0 for one per online processor
+ * @return: 1 if the socket could not be opened, otherwise it does not return
+ */
+int runServer(Interpreter* interpreter, const char* path, int workers);
+
+#endif
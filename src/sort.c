@@ -0,0 +1,145 @@
+/**
+ * @brief: This is the file containing the sort builtin.
+ * The elements are copied into an array and merge sorted there, the first half of a long range on a thread of its own while there are threads left, and short ranges by insertion. The sorted list is built with all its nodes in one allocation
+ * @file: sort.c
+ * @date: 19/10 2026
+ */
+#include "sort.h"
+#include "speculate.h"
+#include "stats.h"
+#include "trace.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SORT_RUN 16 /** Ranges of at most this many values are sorted by insertion */
+#define SORT_FORK 4096 /** Ranges of at least this many values sort their first half on a new thread, if there are threads left */
+
+/**
+ * Defines a range of values to be sorted
+ */
+typedef struct {
+  Val* values; /** The first value of the range */
+  Val* scratch; /** Room for as many values, used when merging */
+  intptr_t length; /** The number of values */
+  SymbolIdent* comparator; /** The user-defined comparator, NULL to sort in the order of < */
+} SortRange;
+
+/**
+ * Compares two values
+ * @return: 1 if the first value goes before the second, 0 otherwise
+ */
+static int sortBefore(SymbolIdent* comparator, Val a, Val b) {
+  if (comparator) {
+    Val values[2] = {a, b};
+    return getIntVal(callSymbol(comparator, values)) != 0;
+  }
+  if (getType(a) == ValueType_INT && getType(b) == ValueType_INT)
+    return getIntVal(a) < getIntVal(b);
+  return getIntVal(evalLesser(a, b)) != 0;
+}
+
+/**
+ * Sorts a short range by insertion, values only move past values they go before
+ */
+static void insertionSort(SortRange* range) {
+  for (intptr_t i = 1; i < range->length; i++) {
+    Val value = range->values[i];
+    intptr_t j = i;
+    for (; j > 0 && sortBefore(range->comparator, value, range->values[j - 1]); j--)
+      range->values[j] = range->values[j - 1];
+    range->values[j] = value;
+  }
+}
+
+/**
+ * Sorts a range by sorting its halves and merging them, this is also the task of the threads sorting first halves
+ * @param: The SortRange
+ */
+static void sortRange(void* data) {
+  SortRange* range = (SortRange*) data;
+  //The value of a cancelled speculation is thrown away, so there is no need to finish
+  if (range->comparator && speculationCancelled())
+    return;
+  if (range->length <= SORT_RUN) {
+    insertionSort(range);
+    return;
+  }
+  intptr_t half = range->length / 2;
+  SortRange first = {range->values, range->scratch, half, range->comparator};
+  SortRange second = {range->values + half, range->scratch + half, range->length - half, range->comparator};
+  pthread_t id = 0;
+  if (range->length >= SORT_FORK) {
+    statsAdd(StatCounter_FORKS_ATTEMPTED, 1);
+    if (context->numThreads < context->maxThreads) {
+      ForkArgs args = {NULL};
+      args.task = sortRange;
+      args.data = &first;
+      id = doFork(&args);
+    }
+    else
+      statsAdd(StatCounter_FORKS_REJECTED, 1);
+  }
+  if (!id)
+    sortRange(&first);
+  sortRange(&second);
+  if (id) {
+    void* bogus;
+    pthread_join(id, &bogus);
+  }
+  if (!sortBefore(range->comparator, range->values[half], range->values[half - 1]))
+    return;
+  //Values of the second half left once the first half is merged are already in place
+  intptr_t i = 0;
+  intptr_t j = half;
+  intptr_t k = 0;
+  while (i < half && j < range->length)
+    range->scratch[k++] = sortBefore(range->comparator, range->values[j], range->values[i]) ? range->values[j++] : range->values[i++];
+  while (i < half)
+    range->scratch[k++] = range->values[i++];
+  memcpy(range->values, range->scratch, sizeof(Val) * k);
+}
+
+/**
+ * Sorts an array of values in place
+ */
+static void sortValues(Val* values, intptr_t length, SymbolIdent* comparator) {
+  Val* scratch = malloc(sizeof(Val) * (length ? length : 1));
+  SortRange range = {values, scratch, length, comparator};
+  sortRange(&range);
+  free(scratch);
+}
+
+/**
+ * Sorts the elements of a list or a vector
+ */
+Val evalSort(Val arg, char* name) {
+  TRACE2(TraceEvent_SORT, 0, 0);
+  SymbolIdent* comparator = NULL;
+  if (name && (hashmap_get(context->symbols, name, (any_t*) &comparator) != MAP_OK ||
+	       !comparator->argNames || !comparator->argNames->next || comparator->argNames->next->next)) {
+    printf("sort needs a function of two arguments\n");
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  }
+  if (getType(arg) == ValueType_VECTOR) {
+    Vector* vector = createVector(getVectorVal(arg)->length);
+    memcpy(vector->elements, getVectorVal(arg)->elements, sizeof(Val) * vector->length);
+    sortValues(vector->elements, vector->length, comparator);
+    return createVal(ValueType_VECTOR, (intptr_t) vector);
+  }
+  if (getType(arg) != ValueType_LIST) {
+    if (!speculationAbort())
+      printf("sort needs a list or a vector\n");
+    return createVal(ValueType_LIST, (intptr_t) NULL);
+  }
+  intptr_t length = getListLength(arg);
+  Val* values = malloc(sizeof(Val) * (length ? length : 1));
+  intptr_t i = 0;
+  for (ValList* node = getListVal(arg); node; node = getNextNode(node))
+    values[i++] = node->value;
+  sortValues(values, length, comparator);
+  ValList* list = createListNodes(values, length);
+  free(values);
+  return createVal(ValueType_LIST, (intptr_t) list);
+}
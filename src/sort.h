@@ -0,0 +1,18 @@
+/**
+ * @brief: Header for the sort builtin, which sorts lists and vectors on the threads of the interpreter
+ * @file: sort.h
+ * @date: 19/10 2026
+ */
+
+#ifndef SORT_HEADER
+#define SORT_HEADER
+#include "eval.h"
+
+/**
+ * Sorts the elements of a list or a vector with a stable merge sort, in the order of < or in the order of a user-defined comparator
+ * @param: The list or vector, and the name of a function of two arguments that is nonzero if its first argument goes before its second, or NULL to sort in the order of <
+ * @return: a new list, or a new vector if the argument is a vector
+ */
+Val evalSort(Val arg, char* comparator);
+
+#endif
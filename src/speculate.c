@@ -0,0 +1,122 @@
+/**
+ * @brief: This is the file containing speculative evaluation of if-then-else.
+ * Both branches are forked before the condition is evaluated, and the branch the condition does not take is cancelled. Cancelled threads return at the next call of a user-defined function with a value that is thrown away, and thunks and lazy lists they were forcing are left to be forced again.
+ * A speculative thread that would fail, by taking the head of an empty list, dividing by zero or running out of stack, gives up instead, and its branch is evaluated again on the thread of the if-then-else should it be taken
+ * @file: speculate.c
+ * @date: 19/10 2026
+ */
+#include "speculate.h"
+#include "stats.h"
+#include <pthread.h>
+#include <string.h>
+
+int speculating = 0;
+
+__thread Speculation* speculation = NULL;
+static __thread char* stackBase = NULL; /** The start of the stack of the thread, if speculative */
+static size_t stackLimit = 0; /** The stack a speculative thread may use, half the default stack size */
+
+/**
+ * Examines whether the thread evaluates for a cancelled speculation, giving up its speculation if it has used too much stack
+ */
+int speculationCancelled(void) {
+  char here;
+  if (!speculation)
+    return 0;
+  if (stackBase && (size_t) (stackBase - &here) > stackLimit)
+    speculation->cancelled = 1;
+  for (Speculation* outer = speculation; outer; outer = outer->parent) {
+    if (outer->cancelled)
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * Gives up the speculation of the thread
+ */
+int speculationAbort(void) {
+  if (!speculation)
+    return 0;
+  speculation->cancelled = 1;
+  return 1;
+}
+
+/**
+ * Marks the start of the stack of a speculative thread
+ */
+void speculationStart(char* base) {
+  stackBase = base;
+  if (!stackLimit) {
+    pthread_attr_t attributes;
+    size_t size;
+    pthread_attr_init(&attributes);
+    pthread_attr_getstacksize(&attributes, &size);
+    pthread_attr_destroy(&attributes);
+    stackLimit = size / 2;
+  }
+}
+
+/**
+ * Examines whether a tree may be expensive enough to be worth a thread, which is when it calls a user-defined function or takes the length of a list
+ * @return: 1 if it is, 0 otherwise
+ */
+static int expensive(TreeNode* node) {
+  if (getType(node->value) != ValueType_FUNCTION)
+    return 0;
+  if (!exists(getCharVal(node->value)) || !strcmp(getCharVal(node->value), "length"))
+    return 1;
+  for (PointerListNode* child = node->argList; child; child = child->next) {
+    if (expensive(child->target))
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * Starts a branch on a new thread
+ * @return: The thread id of the new thread
+ */
+static pthread_t forkBranch(ForkArgs* forkArgs, Speculation* branch) {
+  //The new thread inherits the speculation of the thread that forks it
+  Speculation* outer = speculation;
+  speculation = branch;
+  pthread_t tid = doFork(forkArgs);
+  speculation = outer;
+  return tid;
+}
+
+/**
+ * Evaluates an if-then-else with both branches started on new threads before the condition
+ */
+int evalSpeculative(TreeNode* curr, ArgName args[], int argNum, Val* result) {
+  PointerListNode* children = curr->argList;
+  if (!curr->speculate)
+    curr->speculate = expensive(children->target) && expensive(children->next->target) && expensive(children->next->next->target) ? 1 : -1;
+  if (curr->speculate < 0 || context->numThreads + 2 > context->maxThreads)
+    return 0;
+  statsAdd(StatCounter_SPECULATIONS, 1);
+  Speculation branches[2] = {{0, speculation}, {0, speculation}};
+  ThreadTuple values[2];
+  ForkArgs forkArgs[2];
+  for (int i = 0; i < 2; i++) {
+    forkArgs[i].target = i ? children->next->next->target : children->next->target;
+    forkArgs[i].args = args;
+    forkArgs[i].num = argNum;
+    forkArgs[i].returnVal = &(values[i].value);
+    forkArgs[i].task = NULL;
+    values[i].id = forkBranch(&forkArgs[i], &branches[i]);
+  }
+  int taken = eval(children->target, args, argNum).value.intval ? 0 : 1;
+  branches[1 - taken].cancelled = 1;
+  void* bogus;
+  for (int i = 0; i < 2; i++)
+    pthread_join(values[i].id, &bogus);
+  if (branches[taken].cancelled)
+    *result = eval(forkArgs[taken].target, args, argNum);
+  else {
+    statsAdd(StatCounter_SPECULATION_HITS, 1);
+    *result = values[taken].value;
+  }
+  return 1;
+}
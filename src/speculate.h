@@ -0,0 +1,46 @@
+/**
+ * @brief: Header for speculative evaluation, where both branches of an if-then-else are evaluated on threads of their own while the condition is
+ * @file: speculate.h
+ * @date: 19/10 2026
+ */
+
+#ifndef SPECULATE_HEADER
+#define SPECULATE_HEADER
+#include "eval.h"
+
+extern int speculating; /** Nonzero if expensive if-then-else branches are evaluated speculatively, set before any evaluation */
+
+/**
+ * Defines a branch evaluated speculatively.
+ * The threads evaluating the branch, and the threads they fork, stop at the next call of a user-defined function once it or a speculation it is nested in is cancelled
+ */
+typedef struct Speculation {
+  volatile int cancelled; /** Nonzero once the value is not needed, or the branch can not be evaluated speculatively */
+  struct Speculation* parent; /** The speculation the branch is nested in, NULL if none */
+} Speculation;
+
+extern __thread Speculation* speculation; /** The innermost speculation the thread evaluates for, NULL if it is not speculative, inherited by the threads it forks */
+
+/**
+ * Examines whether the thread evaluates for a cancelled speculation, in which case the value it computes is thrown away and must not be kept anywhere else either. A speculative thread that has used half the default stack size gives up its speculation
+ * @return: 1 if it does, 0 otherwise
+ */
+int speculationCancelled(void);
+/**
+ * Gives up the speculation of the thread, which is then evaluated again should its value be needed. Used where speculative evaluation would fail, so that only evaluation that is needed reports the failure
+ * @return: 1 if the thread was speculative, 0 if the failure is real
+ */
+int speculationAbort(void);
+/**
+ * Marks the start of the stack of a speculative thread
+ * @param: An address on the stack of the function the thread starts in
+ */
+void speculationStart(char* base);
+/**
+ * Evaluates an if-then-else with both branches started on new threads before the condition, if the condition and both branches call functions and two threads are free. The losing branch is cancelled
+ * @param: The if-then-else, the local symbol bindings and their number, and where to store the value
+ * @return: 1 if the value was stored, 0 if the if-then-else must be evaluated as usual
+ */
+int evalSpeculative(TreeNode* curr, ArgName args[], int argNum, Val* result);
+
+#endif
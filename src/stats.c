@@ -0,0 +1,107 @@
+/**
+ * @brief: This is the file containing the runtime statistics.
+ * Every thread counts into its own thread-local block, so counting never synchronizes. The blocks of running threads are linked in a list that readers walk under a lock, and threads fold their counts into the totals when they exit, through a thread-specific key whose destructor runs for every thread that counted.
+ * @file: stats.c
+ * @date: 19/10 2026
+ */
+#include "stats.h"
+#include <pthread.h>
+
+const char* statNames[] = {"nodes", "calls", "forks_attempted", "forks_taken", "forks_rejected", "cons_cells", "cons_bytes", "parser_cells", "parser_bytes", "lookups", "rehashes", "speculations", "speculation_hits", "cache_hits"};
+
+__thread StatsThread statsThread;
+
+static long retired[StatCounter_NUM]; /** The counts of threads that have exited */
+static StatsThread* running = NULL;
+static volatile int peakThreads = 0;
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t statsKey; /** Set on every registered thread, so that statsKeyExit runs when it exits */
+static pthread_once_t statsKeyOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Folds the counters of an exiting thread into the totals, the destructor of statsKey
+ */
+static void statsKeyExit(void* unused) {
+  statsThreadExit();
+}
+
+/**
+ * Creates statsKey, done once
+ */
+static void statsKeyCreate() {
+  pthread_key_create(&statsKey, statsKeyExit);
+}
+
+/**
+ * Adds the current thread to the list of running threads, done on its first count. The thread is removed again when it exits, whichever way it was started
+ */
+void statsRegister() {
+  pthread_once(&statsKeyOnce, statsKeyCreate);
+  pthread_setspecific(statsKey, &statsThread);
+  pthread_mutex_lock(&statsLock);
+  statsThread.registered = 1;
+  statsThread.prev = NULL;
+  statsThread.next = running;
+  if (running)
+    running->prev = &statsThread;
+  running = &statsThread;
+  pthread_mutex_unlock(&statsLock);
+}
+
+/**
+ * Adds the counters of the current thread to the totals and removes it from the list of running threads
+ */
+void statsThreadExit() {
+  if (!statsThread.registered)
+    return;
+  pthread_setspecific(statsKey, NULL);
+  pthread_mutex_lock(&statsLock);
+  for (int i = 0; i < StatCounter_NUM; i++) {
+    retired[i] += statsThread.counts[i];
+    statsThread.counts[i] = 0;
+  }
+  if (statsThread.prev)
+    statsThread.prev->next = statsThread.next;
+  else
+    running = statsThread.next;
+  if (statsThread.next)
+    statsThread.next->prev = statsThread.prev;
+  statsThread.registered = 0;
+  pthread_mutex_unlock(&statsLock);
+}
+
+/**
+ * Records the number of threads running, keeping the highest number seen
+ */
+void statsThreads(int running) {
+  int peak = peakThreads;
+  while (running > peak && !__sync_bool_compare_and_swap(&peakThreads, peak, running))
+    peak = peakThreads;
+}
+
+/**
+ * Sums the counters of all threads, including those that have exited
+ * @return: The highest number of threads running at once, including the main thread
+ */
+int statsSnapshot(long counts[]) {
+  pthread_mutex_lock(&statsLock);
+  for (int i = 0; i < StatCounter_NUM; i++)
+    counts[i] = retired[i];
+  for (StatsThread* thread = running; thread; thread = thread->next)
+    for (int i = 0; i < StatCounter_NUM; i++)
+      counts[i] += thread->counts[i];
+  pthread_mutex_unlock(&statsLock);
+  return peakThreads + 1;
+}
+
+/**
+ * Writes the summed counters as a single line of name=value pairs, prefixed by stats
+ */
+void writeStats(FILE* out) {
+  long counts[StatCounter_NUM];
+  int peak = statsSnapshot(counts);
+  fprintf(out, "stats");
+  for (int i = 0; i < StatCounter_NUM; i++)
+    fprintf(out, " %s=%ld", statNames[i], counts[i]);
+  fprintf(out, " peak_threads=%d\n", peak);
+}
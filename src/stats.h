@@ -0,0 +1,76 @@
+/**
+ * @brief: Header for the runtime statistics, counters kept per thread that are summed when they are read
+ * @file: stats.h
+ * @date: 19/10 2026
+ */
+
+#ifndef STATS_HEADER
+#define STATS_HEADER
+#include <stdio.h>
+
+/**
+ * The counters kept for every thread. The order is the order of the list returned by the stats builtin
+ */
+typedef enum StatCounter {
+  StatCounter_NODES, /** Parse tree nodes evaluated */
+  StatCounter_CALLS, /** Calls of user-defined functions */
+  StatCounter_FORKS_ATTEMPTED, /** Arguments that checkFork considered for a thread of their own, the first accepted one of every call still stays on the calling thread */
+  StatCounter_FORKS_TAKEN, /** Of those, the ones that got a thread */
+  StatCounter_FORKS_REJECTED, /** Of those, the ones refused because all threads were busy */
+  StatCounter_CONS_CELLS, /** List nodes built by cons */
+  StatCounter_CONS_BYTES, /** Bytes of the list nodes built by cons */
+  StatCounter_PARSER_CELLS, /** List nodes built by the parser */
+  StatCounter_PARSER_BYTES, /** Bytes allocated by the parser for parse trees and lists */
+  StatCounter_LOOKUPS, /** Lookups of user-defined symbols */
+  StatCounter_REHASHES, /** Times a hashmap doubled its size */
+  StatCounter_SPECULATIONS, /** If-then-else evaluated with both branches started speculatively */
+  StatCounter_SPECULATION_HITS, /** Of those, the ones where the value of the taken branch was used, rather than evaluated again because the speculation gave up */
+  StatCounter_CACHE_HITS, /** Expressions and values whose value was found in the result cache instead of evaluated */
+  StatCounter_NUM /** The number of counters, not a counter */
+} StatCounter;
+
+/**
+ * Defines the counters of one thread, linked into the list of running threads.
+ */
+typedef struct StatsThread {
+  long counts[StatCounter_NUM]; /** The counters, indexed by StatCounter */
+  int registered; /** Nonzero once the thread is in the list */
+  struct StatsThread* prev; /** The previous running thread */
+  struct StatsThread* next; /** The next running thread */
+} StatsThread;
+
+extern __thread StatsThread statsThread; /** The counters of the current thread */
+extern const char* statNames[]; /** The names of the counters, indexed by StatCounter */
+
+/**
+ * Adds the current thread to the list of running threads, done on its first count. The thread is removed again when it exits, whichever way it was started
+ */
+void statsRegister();
+/**
+ * Adds the counters of the current thread to the totals and removes it from the list of running threads. Runs by itself when a counting thread exits, a thread may call it earlier
+ */
+void statsThreadExit();
+/**
+ * Records the number of threads running, keeping the highest number seen
+ */
+void statsThreads(int running);
+/**
+ * Adds to a counter of the current thread
+ */
+static inline void statsAdd(StatCounter counter, long amount) {
+  if (!statsThread.registered)
+    statsRegister();
+  statsThread.counts[counter] += amount;
+}
+/**
+ * Sums the counters of all threads, including those that have exited
+ * @param: An array of StatCounter_NUM counters to fill
+ * @return: The highest number of threads running at once, including the main thread
+ */
+int statsSnapshot(long counts[]);
+/**
+ * Writes the summed counters as a single line of name=value pairs, prefixed by stats
+ */
+void writeStats(FILE* out);
+
+#endif
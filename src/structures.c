@@ -5,9 +5,16 @@
  * @date: 4/7 2013
  */
 #include "structures.h"
+#include "hashcons.h"
+#include <sched.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+/**
+ * Marks ordinary nodes that could not be hash-consed because they reach a lazy node, there is nothing to force
+ */
+static ListThunk unsharedThunk = {NULL, -1, {{0}, 0}, 0, NULL, NULL, ThunkState_DONE};
+
 /**
  * Obtains the type of a value as an enum
  * @return the type of the value
@@ -22,6 +29,8 @@ ValueType getType (Val v) {
     return ValueType_CONSTANT;
   case 3:
     return ValueType_FUNCTION;
+  case 4:
+    return ValueType_VECTOR;
   }
   return ValueType_INT;
 }
@@ -44,35 +53,49 @@ ValList* getListVal(Val v) {
 
 /**
  * Obtains a the length of a list
- * @return: the length of the list that is identified by the Val
+ * @return: the length of the list that is identified by the Val, or the number of elements if it is a vector
  */
 int getListLength(Val v) {
+  if (getType(v) == ValueType_VECTOR)
+    return getVectorVal(v)->length;
   ValList* tempList = getListVal(v);  
-  if(!tempList){
-    return 0;
-  }
-  else{
-    int i = 1;
-    while(tempList->next){
-      tempList = tempList->next;
-      i++;
-    }
-    return i;
+  int i = 0;
+  while(tempList){
+    i++;
+    if (tempList->rest && tempList->rest->state != ThunkState_DONE &&
+	tempList->rest->length >= 0)
+      return i + tempList->rest->length;
+    tempList = getNextNode(tempList);
   }
+  return i;
 }
 
 /**
- * Checks wether two lists are equal
+ * Checks wether two lists are equal, nested lists are compared element by element
  * @return: returns 1 of the list identified by the first Val is equal to the list identified by the second Val, return 0 otherwise.
  */
 int getListsEqual(Val arg1, Val arg2) {
   ValList* tempList1 = getListVal(arg1);
   ValList* tempList2 = getListVal(arg2);
   while(tempList1 && tempList2){
-    if(getIntVal(tempList1->value) != getIntVal(tempList2->value))
+    if (tempList1 == tempList2)
+      return 1;
+    if (hashConsing && !tempList1->rest && !tempList2->rest)
+      return 0;
+    if(getType(tempList1->value) != getType(tempList2->value))
       return 0;
-    tempList1 = tempList1->next;
-    tempList2 = tempList2->next;
+    if(getType(tempList1->value) == ValueType_LIST){
+      if(!getListsEqual(tempList1->value, tempList2->value))
+	return 0;
+    }
+    else if(getType(tempList1->value) == ValueType_VECTOR){
+      if(!getVectorsEqual(tempList1->value, tempList2->value))
+	return 0;
+    }
+    else if(getIntVal(tempList1->value) != getIntVal(tempList2->value))
+      return 0;
+    tempList1 = getNextNode(tempList1);
+    tempList2 = getNextNode(tempList2);
   }
   if((!tempList1 && !tempList2)){
     return 1;
@@ -81,7 +104,164 @@ int getListsEqual(Val arg1, Val arg2) {
     return 0;
   }
 }
-     
+
+/**
+ * Obtains a vector from a val
+ * @return: a pointer to the vector identified by the Val
+ */
+Vector* getVectorVal(Val v) {
+  return v.value.vector;
+}
+
+/**
+ * Builds a new vector whose elements are allocated with it
+ * @return: a pointer to the new vector
+ */
+Vector* createVector(intptr_t length) {
+  Vector* vector = malloc(sizeof(Vector) + sizeof(Val) * length);
+  vector->elements = (Val*) (vector + 1);
+  vector->length = length;
+  return vector;
+}
+
+/**
+ * Builds a view of the elements of a vector between two indices, without copying them
+ * @return: a pointer to the new vector
+ */
+Vector* createSlice(Vector* vector, intptr_t from, intptr_t to) {
+  if (to > vector->length)
+    to = vector->length;
+  if (from < 0)
+    from = 0;
+  if (to < from)
+    to = from;
+  Vector* slice = malloc(sizeof(Vector));
+  slice->elements = vector->elements + from;
+  slice->length = to - from;
+  return slice;
+}
+
+/**
+ * Checks wether two vectors are equal, nested lists and vectors are compared element by element
+ * @return: returns 1 if the vector identified by the first Val is equal to the vector identified by the second Val, return 0 otherwise.
+ */
+int getVectorsEqual(Val arg1, Val arg2) {
+  Vector* vector1 = getVectorVal(arg1);
+  Vector* vector2 = getVectorVal(arg2);
+  if (vector1->length != vector2->length)
+    return 0;
+  if (vector1->elements == vector2->elements)
+    return 1;
+  for (intptr_t i = 0; i < vector1->length; i++) {
+    Val element1 = vector1->elements[i];
+    Val element2 = vector2->elements[i];
+    if (getType(element1) != getType(element2))
+      return 0;
+    if (getType(element1) == ValueType_LIST) {
+      if (!getListsEqual(element1, element2))
+	return 0;
+    }
+    else if (getType(element1) == ValueType_VECTOR) {
+      if (!getVectorsEqual(element1, element2))
+	return 0;
+    }
+    else if (getIntVal(element1) != getIntVal(element2))
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * Builds a new list node, if hash-consing is enabled the node is interned instead
+ * @return: a pointer to a node with the given value and tail
+ */
+ValList* createListNode(Val value, ValList* next) {
+  int shared = hashConsing;
+  if (shared && next && next->rest)
+    shared = 0;
+  //Equal vectors are not the same vector, so nodes holding them are not interned
+  if (shared && getType(value) == ValueType_VECTOR)
+    shared = 0;
+  if (shared && getType(value) == ValueType_LIST &&
+      getListVal(value) && getListVal(value)->rest)
+    shared = 0;
+  if (shared)
+    return internListNode(value, next);
+  ValList* newNode = malloc(sizeof(ValList));
+  newNode->value = value;
+  newNode->next = next;
+  newNode->rest = hashConsing ? &unsharedThunk : NULL;
+  return newNode;
+}
+
+/**
+ * Builds a list of the given values, interned nodes are built one at a time
+ * @return: a pointer to the first node, or NULL if there are no values
+ */
+ValList* createListNodes(const Val values[], intptr_t length) {
+  ValList* list = NULL;
+  if (hashConsing) {
+    for (intptr_t i = length; i--;)
+      list = createListNode(values[i], list);
+    return list;
+  }
+  if (!length)
+    return NULL;
+  ValList* nodes = malloc(sizeof(ValList) * length);
+  for (intptr_t i = 0; i < length; i++) {
+    nodes[i].value = values[i];
+    nodes[i].next = i + 1 < length ? &nodes[i + 1] : NULL;
+    nodes[i].rest = NULL;
+  }
+  return nodes;
+}
+
+/**
+ * Defines a lazy list node together with its thunk, so that each lazy node costs one allocation
+ */
+typedef struct {
+  ValList node; /** The node */
+  ListThunk thunk; /** The tail of the node */
+} LazyListNode;
+
+/**
+ * Builds a new list node whose tail is computed on demand by a copy of the given generator
+ * @return: a pointer to the new lazy node
+ */
+ValList* createLazyListNode(Val value, const ListThunk* generator) {
+  LazyListNode* newNode = malloc(sizeof(LazyListNode));
+  newNode->thunk = *generator;
+  newNode->thunk.state = ThunkState_PENDING;
+  newNode->node.value = value;
+  newNode->node.next = NULL;
+  newNode->node.rest = &newNode->thunk;
+  return &newNode->node;
+}
+
+/**
+ * Obtains the node following a list node, forcing the tail of lazy nodes exactly once
+ * @return: the next node, or NULL at the end of the list
+ */
+ValList* getNextNode(ValList* node) {
+  ListThunk* rest = node->rest;
+  if (rest && rest->state != ThunkState_DONE) {
+    while (rest->state != ThunkState_DONE) {
+      if (__sync_bool_compare_and_swap(&rest->state, ThunkState_PENDING, ThunkState_FORCING)) {
+	ValList* next = rest->force(rest);
+	if (rest->state == ThunkState_PENDING)
+	  return next;
+	node->next = next;
+	__sync_synchronize();
+	rest->state = ThunkState_DONE;
+      }
+      else
+	sched_yield();
+    }
+    __sync_synchronize();
+  }
+  return node->next;
+}
+
 /**
  * Obtains a string from a Val
  * @return: a pointer to the begining of the string identified by the Val
@@ -130,6 +310,9 @@ Val createVal(ValueType type, intptr_t value) {
   case ValueType_FUNCTION:
     returnVal.type = 3;
     break;
+  case ValueType_VECTOR:
+    returnVal.type = 4;
+    break;
   }
   returnVal.value.intval = value;
   return returnVal;
@@ -153,7 +336,7 @@ void freeVal(Val target) {
 void freeValList(ValList* target) {
   if (target) {
     freeVal(target->value);
-    freeValList(target->next);
+    freeValList(getNextNode(target));
     free(target);
   }
 }
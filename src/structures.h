@@ -18,10 +18,14 @@ typedef enum ValueType {
   ValueType_INT, 
   ValueType_LIST, 
   ValueType_CONSTANT, 
-  ValueType_FUNCTION
+  ValueType_FUNCTION,
+  ValueType_VECTOR
 } ValueType;
 
 typedef struct ValList;
+struct ListThunk;
+struct Vector;
+struct Context;
 
 /**
  *Defines a value.
@@ -32,6 +36,7 @@ typedef struct {
     intptr_t intval; /** The int value */
     struct ValList* listStart; /** Pointer to first element of the list */
     char* identifier; /** Pointer to the string identifier */
+    struct Vector* vector; /** Pointer to the vector */
   } value; /** The actual value of a Val, can be interpreted in various ways*/
   char type; /** Defines how to interpret the value union */
 } Val;
@@ -42,15 +47,54 @@ typedef struct {
  */
 typedef struct ValList {
   Val value; /** The value of this list node */
-  struct ValList* next; /** The next node */
+  struct ValList* next; /** The next node, only valid once the rest has been forced */
+  struct ListThunk* rest; /** The suspended computation of the next node, NULL for ordinary nodes */
 } ValList;
 
+/**
+ *Defines an immutable vector of values.
+ *Slices share the elements of the vector they are taken from.
+ */
+typedef struct Vector {
+  Val* elements; /** The first element */
+  intptr_t length; /** The number of elements */
+} Vector;
+
+/**
+ *Enumerates the states of a suspended list tail
+ */
+typedef enum ThunkState {
+  ThunkState_PENDING,
+  ThunkState_FORCING,
+  ThunkState_DONE
+} ThunkState;
+
+/**
+ *Defines a suspended computation of the tail of a lazy list node.
+ *The generator fields are interpreted by the force function alone.
+ */
+typedef struct ListThunk {
+  struct ValList* (*force)(struct ListThunk*); /** Computes the node following the one this thunk belongs to, or sets the state back to ThunkState_PENDING to leave it to be computed again */
+  intptr_t length; /** The number of nodes following the one this thunk belongs to, or -1 if unknown */
+  Val current; /** Generator state, usually the value of the node this thunk belongs to */
+  intptr_t limit; /** Generator state, usually where the generator stops */
+  void* source; /** Generator state, usually what the generator reads from */
+  struct Context* context; /** The interpreter whose functions the generator calls, NULL if it calls none */
+  volatile int state; /** The ThunkState of the thunk */
+} ListThunk;
+
 /**
  *Defines a node in the parse tree.
  */
 typedef struct TreeNode {
   struct PointerListNode* argList; /** The list of pointers to the nodes children*/
   Val value; /** The value of the node */
+  char inferred; /** The InferredType of what the node evaluates to, set by type inference */
+  char operation; /** The IntOperation that computes the node from the ints its children evaluate to, set by type inference */
+  char pure; /** Nonzero if the whole tree is computed from int constants and int arguments alone, set by type inference */
+  unsigned char argument; /** The index of the argument the node refers to, set by type inference */
+  char speculate; /** For if-then-else, 0 until the cost of the branches is estimated, then 1 if they are worth evaluating speculatively and -1 if not */
+  char idiom; /** 0 until the node is first evaluated, then the Idiom it is evaluated as, or -1 if none */
 } TreeNode;
 
 /**
@@ -69,6 +113,15 @@ typedef struct SymbolIdent {
   char* name; /** The name of the symbol, if blank, it is merely an executable expression*/
   struct NameListNode* argNames; /** The list of the names of arguments, if blank, then the symbol is either an executable expression or a constant symbol*/
   struct TreeNode* parseTree; /** The parse tree */
+  int calls; /** The number of calls the evaluator has made, counted until the function is compiled, -1 if it can not be */
+  void* native; /** The compiled code of the function, NULL if it has not been compiled */
+  volatile char typed; /** 0 until the types of the function are inferred, then 1 if it has a typed evaluation path and -1 if not */
+  char returns; /** The InferredType of what the function returns */
+  unsigned intArgs; /** The arguments the typed path assumes are ints, as a bit mask */
+  volatile char strictness; /** Nonzero once the strict arguments have been found */
+  unsigned strictArgs; /** The arguments every evaluation of the body evaluates, as a bit mask */
+  struct TreeNode* expression; /** For a value, the expression it is evaluated from when first used, NULL if parseTree always holds the value */
+  volatile int state; /** For a value with an expression, the ThunkState of the value in parseTree */
 } SymbolIdent;
 
 /**
@@ -117,14 +170,54 @@ char* getCharVal(Val v);
 ValList* getListVal (Val v);
 /**
  * Obtains a the length of a list
- * @return: the length of the list that is identified by the Val
+ * @return: the length of the list that is identified by the Val, or the number of elements if it is a vector
  */
 int getListLength(Val v);
 /**
- * Checks wether two lists are equal
+ * Checks wether two lists are equal, nested lists are compared element by element
  * @return: returns 1 of the list identified by the first Val is equal to the list identified by the second Val, return 0 otherwise.
  */
 int getListsEqual(Val arg1, Val arg2);
+/**
+ * Obtains a vector from a val
+ * @return: a pointer to the vector identified by the Val
+ */
+Vector* getVectorVal(Val v);
+/**
+ * Builds a new vector whose elements are allocated with it and left for the caller to fill in
+ * @return: a pointer to the new vector
+ */
+Vector* createVector(intptr_t length);
+/**
+ * Builds a view of the elements of a vector from an index up to, but not including, another, without copying them. The indices are clamped to the vector
+ * @return: a pointer to the new vector
+ */
+Vector* createSlice(Vector* vector, intptr_t from, intptr_t to);
+/**
+ * Checks wether two vectors are equal, nested lists and vectors are compared element by element
+ * @return: returns 1 if the vector identified by the first Val is equal to the vector identified by the second Val, return 0 otherwise.
+ */
+int getVectorsEqual(Val arg1, Val arg2);
+/**
+ * Builds a new list node, if hash-consing is enabled the node is interned instead
+ * @return: a pointer to a node with the given value and tail
+ */
+ValList* createListNode(Val value, ValList* next);
+/**
+ * Builds a list of the given values, allocating all its nodes at once unless hash-consing is enabled
+ * @return: a pointer to the first node, or NULL if there are no values
+ */
+ValList* createListNodes(const Val values[], intptr_t length);
+/**
+ * Builds a new list node whose tail is computed on demand by a copy of the given generator
+ * @return: a pointer to the new lazy node
+ */
+ValList* createLazyListNode(Val value, const ListThunk* generator);
+/**
+ * Obtains the node following a list node, forcing the tail of lazy nodes exactly once
+ * @return: the next node, or NULL at the end of the list
+ */
+ValList* getNextNode(ValList* node);
 /**
  * Frees the memory allocated to a SymbolIdent, and recursively to all things it may point to
  */
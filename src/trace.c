@@ -0,0 +1,292 @@
+/**
+ * @brief: This is the file containing the tracing.
+ * Every thread records binary events in its own ring buffer, which only that thread writes and only the drainer thread reads, so recording takes no locks. The drainer formats the events and writes them to the debug stream
+ * @file: trace.c
+ * @date: 19/10 2026
+ */
+#include "trace.h"
+#include "structures.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RING_SIZE 4096 /** Events per ring buffer, a power of two */
+#define TRACE_NAME_SIZE 32 /** Bytes kept of a name an event refers to, longer names are cut off */
+
+/**
+ * Defines how the arguments of an event are printed.
+ */
+typedef enum TraceArgs {
+  TraceArgs_NONE,
+  TraceArgs_NAME,
+  TraceArgs_VALUE,
+  TraceArgs_TREE,
+  TraceArgs_THREAD
+} TraceArgs;
+
+/**
+ * Defines the text of an event.
+ */
+typedef struct {
+  const char* text; /** What happened */
+  TraceArgs args; /** How the arguments are printed after the text */
+} TraceName;
+
+static const TraceName traceNames[] = {
+  {"executing a plus operation", TraceArgs_NONE},
+  {"executing a minus operation", TraceArgs_NONE},
+  {"executing a division operation", TraceArgs_NONE},
+  {"executing a multiplication operation", TraceArgs_NONE},
+  {"executing a equality operation", TraceArgs_NONE},
+  {"executing a header operation", TraceArgs_NONE},
+  {"executing a tail operation", TraceArgs_NONE},
+  {"executing a length operation", TraceArgs_NONE},
+  {"executing a consbox operation", TraceArgs_NONE},
+  {"executing a range operation", TraceArgs_NONE},
+  {"executing an iterate operation", TraceArgs_NONE},
+  {"executing a stats operation", TraceArgs_NONE},
+  {"executing an nth operation", TraceArgs_NONE},
+  {"executing a slice operation", TraceArgs_NONE},
+  {"executing a concat operation", TraceArgs_NONE},
+  {"executing a vector length operation", TraceArgs_NONE},
+  {"executing a tovector operation", TraceArgs_NONE},
+  {"executing a tolist operation", TraceArgs_NONE},
+  {"executing a sort operation", TraceArgs_NONE},
+  {"executing a less-than operation", TraceArgs_NONE},
+  {"evaluating a node", TraceArgs_NONE},
+  {"evaluated from arguments", TraceArgs_NAME},
+  {"evaluated a if-then-else case", TraceArgs_NONE},
+  {"executing a timing operation", TraceArgs_NONE},
+  {"executing a detailed timing operation", TraceArgs_NONE},
+  {"evaluated an iterate case", TraceArgs_NONE},
+  {"evaluated a fused idiom", TraceArgs_NONE},
+  {"executing arguments (if any)", TraceArgs_NONE},
+  {"evaluated user-defined symbol", TraceArgs_NAME},
+  {"evaluated constant value", TraceArgs_VALUE},
+  {"finished working on tree", TraceArgs_TREE},
+  {"created thread working on tree", TraceArgs_THREAD},
+  {"made function", TraceArgs_NONE},
+  {"made value", TraceArgs_NONE},
+  {"made base expression", TraceArgs_NONE},
+  {"made expression infix function call to", TraceArgs_NAME},
+  {"made if-then-else expression", TraceArgs_NONE},
+  {"made expression function call", TraceArgs_NONE},
+  {"made expression symbol reference to", TraceArgs_NAME},
+  {"made expression constant value", TraceArgs_NONE},
+  {"made list", TraceArgs_NONE},
+  {"made vector", TraceArgs_NONE},
+  {"made negative number", TraceArgs_NONE},
+  {"made number", TraceArgs_NONE},
+  {"made loaded list", TraceArgs_NONE}
+};
+
+/**
+ * Defines a recorded event.
+ */
+typedef struct {
+  int64_t time; /** Nanoseconds since tracing started */
+  intptr_t a; /** The first argument */
+  intptr_t b; /** The second argument */
+  TraceEvent event; /** What happened */
+  char name[TRACE_NAME_SIZE]; /** A copy of the name the event refers to, if any, as the name may be freed before the event is written */
+} TraceRecord;
+
+/**
+ * Defines the ring buffer of one thread.
+ */
+typedef struct TraceRing {
+  TraceRecord records[RING_SIZE]; /** The events */
+  volatile unsigned long head; /** The number of events recorded, only written by the thread */
+  volatile unsigned long tail; /** The number of events written out, only written by the drainer */
+  long dropped; /** The number of events lost because the ring was full when tracing stopped */
+  int thread; /** The number of the thread, in the order threads started tracing */
+  volatile int finished; /** Nonzero once the thread has exited */
+  struct TraceRing* next; /** The next ring in the list of all rings */
+} TraceRing;
+
+volatile int tracing = 0;
+
+static __thread TraceRing* ring = NULL;
+static TraceRing* rings = NULL;
+static int ringNum = 0;
+static pthread_mutex_t ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t drainer;
+static volatile int draining = 0;
+static FILE* traceOut = NULL;
+static struct timespec traceStartTime;
+
+/**
+ * Obtains the time since tracing started
+ * @return: the time in nanoseconds
+ */
+static int64_t traceNow() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (int64_t) (t.tv_sec - traceStartTime.tv_sec) * 1000000000 + (t.tv_nsec - traceStartTime.tv_nsec);
+}
+
+/**
+ * Records an event in the ring buffer of the current thread. If the buffer is full the thread waits for the drainer, events are only dropped and counted once tracing stops
+ */
+void traceEvent(TraceEvent event, intptr_t a, intptr_t b) {
+  if (!ring) {
+    ring = calloc(1, sizeof(TraceRing));
+    pthread_mutex_lock(&ringsLock);
+    ring->thread = ringNum++;
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&ringsLock);
+  }
+  unsigned long head = ring->head;
+  //A full ring waits for the drainer rather than losing the event, unless tracing is stopping
+  while (head - ring->tail == RING_SIZE) {
+    if (!draining) {
+      ring->dropped++;
+      return;
+    }
+    sched_yield();
+  }
+  TraceRecord* record = &ring->records[head & (RING_SIZE - 1)];
+  record->time = traceNow();
+  record->a = a;
+  record->b = b;
+  record->event = event;
+  TraceArgs args = traceNames[event].args;
+  const char* name = NULL;
+  if (args == TraceArgs_NAME)
+    name = (const char*) a;
+  else if (args == TraceArgs_VALUE && a != ValueType_INT && a != ValueType_LIST && a != ValueType_VECTOR)
+    name = (const char*) b;
+  if (name || args == TraceArgs_NAME)
+    strncpy(record->name, name ? name : "(null)", TRACE_NAME_SIZE - 1);
+  __sync_synchronize();
+  ring->head = head + 1;
+}
+
+/**
+ * Marks the ring buffer of the current thread as finished, must be called before a traced thread exits
+ */
+void traceThreadExit() {
+  if (ring) {
+    __sync_synchronize();
+    ring->finished = 1;
+    ring = NULL;
+  }
+}
+
+/**
+ * Writes one event to the trace stream
+ */
+static void writeRecord(int thread, TraceRecord* record) {
+  const TraceName* name = &traceNames[record->event];
+  fprintf(traceOut, "%lld %d: %s", (long long) record->time, thread, name->text);
+  switch (name->args) {
+  case TraceArgs_NAME:
+    fprintf(traceOut, " %s", record->name);
+    break;
+  case TraceArgs_VALUE:
+    if (record->a == ValueType_INT)
+      fprintf(traceOut, " %ld", (long) record->b);
+    else if (record->a == ValueType_LIST)
+      fprintf(traceOut, " list %p", (void*) record->b);
+    else if (record->a == ValueType_VECTOR)
+      fprintf(traceOut, " vector %p", (void*) record->b);
+    else
+      fprintf(traceOut, " %s", record->name);
+    break;
+  case TraceArgs_TREE:
+    fprintf(traceOut, " %p", (void*) record->a);
+    break;
+  case TraceArgs_THREAD:
+    fprintf(traceOut, " %lu %p", (unsigned long) record->a, (void*) record->b);
+    break;
+  default:
+    break;
+  }
+  fputc('\n', traceOut);
+}
+
+/**
+ * Writes out every event recorded so far, and frees the rings of threads that have exited
+ * @return: the number of events written
+ */
+static long drainRings() {
+  long written = 0;
+  pthread_mutex_lock(&ringsLock);
+  TraceRing** link = &rings;
+  while (*link) {
+    TraceRing* current = *link;
+    int finished = current->finished;
+    __sync_synchronize();
+    unsigned long head = current->head;
+    __sync_synchronize();
+    for (unsigned long tail = current->tail; tail != head; tail++) {
+      writeRecord(current->thread, &current->records[tail & (RING_SIZE - 1)]);
+      written++;
+    }
+    __sync_synchronize();
+    current->tail = head;
+    if (finished) {
+      if (current->dropped)
+	fprintf(traceOut, "%d: dropped %ld events\n", current->thread, current->dropped);
+      *link = current->next;
+      free(current);
+    }
+    else
+      link = &current->next;
+  }
+  pthread_mutex_unlock(&ringsLock);
+  return written;
+}
+
+/**
+ * The drainer thread, writes out events until tracing stops
+ * @return: Always return 0
+ */
+static void* drainLoop(void* unused) {
+  struct timespec pause = {0, 1000000};
+  while (draining) {
+    if (!drainRings()) {
+      fflush(traceOut);
+      nanosleep(&pause, NULL);
+    }
+  }
+  drainRings();
+  pthread_mutex_lock(&ringsLock);
+  for (TraceRing* current = rings; current; current = current->next)
+    if (current->dropped)
+      fprintf(traceOut, "%d: dropped %ld events\n", current->thread, current->dropped);
+  pthread_mutex_unlock(&ringsLock);
+  fflush(traceOut);
+  return 0;
+}
+
+/**
+ * Starts collecting events and the thread that writes them to a stream
+ */
+void traceStart(FILE* out) {
+#if TRACE >= 1
+  if (draining)
+    return;
+  traceOut = out;
+  clock_gettime(CLOCK_MONOTONIC, &traceStartTime);
+  draining = 1;
+  pthread_create(&drainer, NULL, drainLoop, NULL);
+  tracing = 1;
+#else
+  printf("Tracing is not compiled in, build with DEBUG=y\n");
+#endif
+}
+
+/**
+ * Stops collecting events, and waits until all collected events are written
+ */
+void traceStop() {
+  if (!draining)
+    return;
+  tracing = 0;
+  draining = 0;
+  pthread_join(drainer, NULL);
+}
@@ -0,0 +1,98 @@
+/**
+ * @brief: Header for tracing, the debug output of the evaluator and the parser.
+ * Trace points are compiled in up to the level given by the TRACE macro, which the Makefile sets from DEBUG. Level 1 traces calls, threads and the parser, level 2 also every node and built-in operation
+ * @file: trace.h
+ * @date: 19/10 2026
+ */
+
+#ifndef TRACE_HEADER
+#define TRACE_HEADER
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef TRACE
+#define TRACE 0
+#endif
+
+/**
+ * The events that can be traced, traceNames in trace.c holds the text of each
+ */
+typedef enum TraceEvent {
+  TraceEvent_PLUS,
+  TraceEvent_MINUS,
+  TraceEvent_DIVIDE,
+  TraceEvent_MULT,
+  TraceEvent_EQUAL,
+  TraceEvent_HEAD,
+  TraceEvent_TAIL,
+  TraceEvent_LENGTH,
+  TraceEvent_CONS,
+  TraceEvent_RANGE,
+  TraceEvent_ITERATE,
+  TraceEvent_STATS,
+  TraceEvent_NTH,
+  TraceEvent_SLICE,
+  TraceEvent_CONCAT,
+  TraceEvent_LEN,
+  TraceEvent_TOVECTOR,
+  TraceEvent_TOLIST,
+  TraceEvent_SORT,
+  TraceEvent_LESSER,
+  TraceEvent_NODE,
+  TraceEvent_ARGUMENT, /** a is the name of the argument */
+  TraceEvent_ITE,
+  TraceEvent_TIME,
+  TraceEvent_TIMING,
+  TraceEvent_ITERATE_CASE,
+  TraceEvent_IDIOM,
+  TraceEvent_ARGUMENTS,
+  TraceEvent_CALL, /** a is the name of the function */
+  TraceEvent_CONSTANT, /** a is the ValueType and b the value of the constant */
+  TraceEvent_FINISHED, /** a is the tree the thread evaluated */
+  TraceEvent_CREATED, /** a is the new thread and b the tree it evaluates */
+  TraceEvent_MADE_FUNCTION,
+  TraceEvent_MADE_VALUE,
+  TraceEvent_MADE_BASE,
+  TraceEvent_MADE_INFIX, /** a is the name of the function */
+  TraceEvent_MADE_ITE,
+  TraceEvent_MADE_CALL,
+  TraceEvent_MADE_REFERENCE, /** a is the name of the symbol */
+  TraceEvent_MADE_CONSTANT,
+  TraceEvent_MADE_LIST,
+  TraceEvent_MADE_VECTOR,
+  TraceEvent_MADE_NEGATIVE,
+  TraceEvent_MADE_NUMBER,
+  TraceEvent_MADE_LOADED
+} TraceEvent;
+
+extern volatile int tracing; /** Nonzero while trace events are collected */
+
+#if TRACE >= 1
+#define TRACE1(event, a, b) do {if (tracing) traceEvent(event, (intptr_t) (a), (intptr_t) (b));} while (0)
+#else
+#define TRACE1(event, a, b) ((void) 0)
+#endif
+#if TRACE >= 2
+#define TRACE2(event, a, b) do {if (tracing) traceEvent(event, (intptr_t) (a), (intptr_t) (b));} while (0)
+#else
+#define TRACE2(event, a, b) ((void) 0)
+#endif
+
+/**
+ * Records an event in the ring buffer of the current thread. If the buffer is full the thread waits for it to be drained
+ */
+void traceEvent(TraceEvent event, intptr_t a, intptr_t b);
+/**
+ * Marks the ring buffer of the current thread as finished, must be called before a traced thread exits
+ */
+void traceThreadExit();
+/**
+ * Starts collecting events and the thread that writes them to a stream
+ */
+void traceStart(FILE* out);
+/**
+ * Stops collecting events, and waits until all collected events are written
+ */
+void traceStop();
+
+#endif
@@ -0,0 +1,268 @@
+/**
+ * @brief: This is the file containing the type inference.
+ * The result types of a group of functions that call each other are found together by iterating until nothing changes, starting from functions that never return. The nodes are then annotated with their types and with the int operation they compute, which the evaluator uses to skip the type checks, the lookup of builtins by name and the lookup of arguments by name.
+ * A tree that only computes with int constants and int arguments is marked pure and is evaluated without creating any values for its subtrees
+ * @file: types.c
+ * @date: 19/10 2026
+ */
+#include "types.h"
+#include "eval.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_INT_ARGS 32 /** The number of arguments that fit in intArgs */
+
+int typing = 0;
+
+/**
+ * Defines the functions inferred together.
+ */
+typedef struct {
+  SymbolIdent** symbols; /** The functions */
+  int num; /** The number of functions */
+  int capacity; /** The size of symbols */
+} TypeGroup;
+
+static pthread_mutex_t typesLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Finds which argument a name is
+ * @return: the index of the argument, or -1 if the name is not an argument
+ */
+static int argumentIndex(NameListNode* names, const char* name) {
+  for (int i = 0; names; names = names->next, i++) {
+    if (!strcmp(names->name, name))
+      return i;
+  }
+  return -1;
+}
+
+/**
+ * Finds the int operation a builtin computes from two ints
+ * @return: the operation, or IntOperation_NONE if the name is not one
+ */
+static IntOperation operationOf(const char* name) {
+  if (!strcmp(name, "plus")) return IntOperation_PLUS;
+  if (!strcmp(name, "minus")) return IntOperation_MINUS;
+  if (!strcmp(name, "mult")) return IntOperation_MULT;
+  if (!strcmp(name, "divide")) return IntOperation_DIVIDE;
+  if (!strcmp(name, "equals")) return IntOperation_EQUALS;
+  if (!strcmp(name, "lesser")) return IntOperation_LESSER;
+  if (!strcmp(name, "greater")) return IntOperation_GREATER;
+  return IntOperation_NONE;
+}
+
+/**
+ * Finds the type the other builtins return, whatever their arguments are
+ */
+static InferredType resultOf(const char* name) {
+  if (!strcmp(name, "length") || !strcmp(name, "len") || !strcmp(name, "time"))
+    return InferredType_INT;
+  if (!strcmp(name, "hd") || !strcmp(name, "nth"))
+    return InferredType_UNKNOWN;
+  return InferredType_LIST;
+}
+
+/**
+ * Joins the types of two values that may be the result of the same node
+ */
+static InferredType join(InferredType a, InferredType b) {
+  if (a == InferredType_NONE)
+    return b;
+  if (b == InferredType_NONE || a == b)
+    return a;
+  return InferredType_UNKNOWN;
+}
+
+/**
+ * Looks up the function a node calls
+ * @return: the function, or NULL if it is not a user-defined function with arguments
+ */
+static SymbolIdent* callee(TreeNode* node) {
+  SymbolIdent* symbol;
+  if (exists(getCharVal(node->value)) || hashmap_get(context->symbols, getCharVal(node->value), (any_t*) &symbol) != MAP_OK || !symbol->argNames)
+    return NULL;
+  return symbol;
+}
+
+/**
+ * Adds a function to the group, along with the functions it calls that have not been inferred
+ */
+static void collect(TypeGroup* group, SymbolIdent* symbol);
+
+/**
+ * Adds the functions a tree calls to the group
+ */
+static void collectTree(TypeGroup* group, TreeNode* node) {
+  if (getType(node->value) != ValueType_FUNCTION)
+    return;
+  SymbolIdent* symbol = callee(node);
+  if (symbol)
+    collect(group, symbol);
+  for (PointerListNode* child = node->argList; child; child = child->next)
+    collectTree(group, child->target);
+}
+
+static void collect(TypeGroup* group, SymbolIdent* symbol) {
+  if (symbol->typed)
+    return;
+  for (int i = 0; i < group->num; i++) {
+    if (group->symbols[i] == symbol)
+      return;
+  }
+  if (group->num == group->capacity) {
+    group->capacity = 2 * group->capacity + 4;
+    group->symbols = realloc(group->symbols, sizeof(SymbolIdent*) * group->capacity);
+  }
+  group->symbols[group->num++] = symbol;
+  symbol->returns = InferredType_NONE;
+  collectTree(group, symbol->parseTree);
+}
+
+/**
+ * Infers the type of a tree, and annotates its nodes if asked to
+ * @param: The tree, the function it belongs to, the arguments assumed to be ints, and whether to annotate
+ * @return: the type of the tree
+ */
+static InferredType inferTree(TreeNode* node, SymbolIdent* symbol, unsigned intArgs, int annotate) {
+  if (annotate) {
+    node->operation = IntOperation_NONE;
+    node->pure = 0;
+  }
+  InferredType type = InferredType_UNKNOWN;
+  switch (getType(node->value)) {
+  case ValueType_INT:
+    type = InferredType_INT;
+    if (annotate) {
+      node->operation = IntOperation_CONSTANT;
+      node->pure = 1;
+    }
+    break;
+  case ValueType_LIST:
+  case ValueType_VECTOR:
+    type = InferredType_LIST;
+    break;
+  case ValueType_CONSTANT: {
+    //Values are left unknown, they may not have been evaluated yet
+    int index = argumentIndex(symbol->argNames, getCharVal(node->value));
+    if (index >= 0 && index < MAX_INT_ARGS && (intArgs >> index & 1)) {
+      type = InferredType_INT;
+      if (annotate) {
+	node->operation = IntOperation_ARGUMENT;
+	node->argument = index;
+	node->pure = 1;
+      }
+    }
+    break;
+  }
+  case ValueType_FUNCTION: {
+    InferredType children[3] = {InferredType_UNKNOWN, InferredType_UNKNOWN, InferredType_UNKNOWN};
+    int pure = 1;
+    int i = 0;
+    for (PointerListNode* child = node->argList; child; child = child->next, i++) {
+      InferredType childType = inferTree(child->target, symbol, intArgs, annotate);
+      if (i < 3)
+	children[i] = childType;
+      pure = pure && child->target->pure;
+    }
+    char* name = getCharVal(node->value);
+    IntOperation operation = operationOf(name);
+    if (!strcmp(name, "ite")) {
+      type = join(children[1], children[2]);
+      operation = IntOperation_ITE;
+    }
+    else if (operation != IntOperation_NONE) {
+      type = InferredType_INT;
+      if (i != 2 || children[0] != InferredType_INT || children[1] != InferredType_INT)
+	operation = IntOperation_NONE;
+    }
+    else if (exists(name))
+      type = resultOf(name);
+    else {
+      SymbolIdent* called = callee(node);
+      if (called)
+	type = called->returns;
+    }
+    if (annotate && operation != IntOperation_NONE) {
+      node->operation = operation;
+      node->pure = pure;
+    }
+    break;
+  }
+  }
+  if (annotate)
+    node->inferred = type;
+  return type;
+}
+
+/**
+ * Finds the arguments of a function that are used directly as operands of an int operation, next to an operand that is not a list
+ * @return: the arguments as a bit mask
+ */
+static unsigned findIntArgs(TreeNode* node, SymbolIdent* symbol) {
+  if (getType(node->value) != ValueType_FUNCTION)
+    return 0;
+  unsigned intArgs = 0;
+  PointerListNode* first = node->argList;
+  if (operationOf(getCharVal(node->value)) != IntOperation_NONE && first && first->next && !first->next->next) {
+    TreeNode* operands[2] = {first->target, first->next->target};
+    for (int i = 0; i < 2; i++) {
+      if (getType(operands[i]->value) != ValueType_CONSTANT)
+	continue;
+      int index = argumentIndex(symbol->argNames, getCharVal(operands[i]->value));
+      if (index >= 0 && index < MAX_INT_ARGS && inferTree(operands[1 - i], symbol, 0, 0) != InferredType_LIST)
+	intArgs |= 1u << index;
+    }
+  }
+  for (PointerListNode* child = node->argList; child; child = child->next)
+    intArgs |= findIntArgs(child->target, symbol);
+  return intArgs;
+}
+
+/**
+ * Examines whether a tree has a node the typed evaluation computes differently
+ */
+static int hasOperation(TreeNode* node) {
+  if (node->operation != IntOperation_NONE)
+    return 1;
+  for (PointerListNode* child = node->argList; child; child = child->next) {
+    if (hasOperation(child->target))
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * Infers the types of a function and every function it calls that has not been inferred yet
+ */
+void inferTypes(SymbolIdent* symbol) {
+  pthread_mutex_lock(&typesLock);
+  TypeGroup group = {NULL, 0, 0};
+  collect(&group, symbol);
+  int changed = 1;
+  while (changed) {
+    changed = 0;
+    for (int i = 0; i < group.num; i++) {
+      InferredType returns = join(group.symbols[i]->returns, inferTree(group.symbols[i]->parseTree, group.symbols[i], 0, 0));
+      if (returns != group.symbols[i]->returns) {
+	group.symbols[i]->returns = returns;
+	changed = 1;
+      }
+    }
+  }
+  for (int i = 0; i < group.num; i++) {
+    if (group.symbols[i]->returns == InferredType_NONE)
+      group.symbols[i]->returns = InferredType_UNKNOWN;
+  }
+  for (int i = 0; i < group.num; i++) {
+    SymbolIdent* member = group.symbols[i];
+    member->intArgs = findIntArgs(member->parseTree, member);
+    inferTree(member->parseTree, member, member->intArgs, 1);
+  }
+  __sync_synchronize();
+  for (int i = 0; i < group.num; i++)
+    group.symbols[i]->typed = hasOperation(group.symbols[i]->parseTree) ? 1 : -1;
+  free(group.symbols);
+  pthread_mutex_unlock(&typesLock);
+}
@@ -0,0 +1,47 @@
+/**
+ * @brief: Header for the type inference, which finds the arguments and subexpressions of functions that are always ints so that they can be evaluated without type checks
+ * @file: types.h
+ * @date: 19/10 2026
+ */
+
+#ifndef TYPES_HEADER
+#define TYPES_HEADER
+#include "structures.h"
+
+/**
+ * The types inferred for nodes and function results. UNKNOWN is the type of anything that may be either
+ */
+typedef enum InferredType {
+  InferredType_UNKNOWN, /** May be an int, a list or a vector */
+  InferredType_INT, /** Always an int */
+  InferredType_LIST, /** Always a list or a vector */
+  InferredType_NONE /** Never returns, used while the results of recursive functions are inferred */
+} InferredType;
+
+/**
+ * The operations a node with int children computes, NONE for every other node
+ */
+typedef enum IntOperation {
+  IntOperation_NONE,
+  IntOperation_CONSTANT, /** An int constant */
+  IntOperation_ARGUMENT, /** An argument that is an int */
+  IntOperation_PLUS,
+  IntOperation_MINUS,
+  IntOperation_MULT,
+  IntOperation_DIVIDE,
+  IntOperation_EQUALS,
+  IntOperation_LESSER,
+  IntOperation_GREATER,
+  IntOperation_ITE /** An if-then-else, only the condition is known to be an int unless the node is pure */
+} IntOperation;
+
+extern int typing; /** Nonzero if functions are evaluated along their typed paths, set before any evaluation */
+
+/**
+ * Infers the types of a function and every function it calls that has not been inferred yet.
+ * The result type of every function is found first, assuming nothing of the arguments. An argument is then assumed to be an int if the function uses it directly as an operand of + - * div = < > next to something that is not a list, and every node is annotated under that assumption. The assumption is checked on every call, functions called with a list where an int was assumed are evaluated as usual
+ * @param: The function, defined in the interpreter of the current thread
+ */
+void inferTypes(SymbolIdent* symbol);
+
+#endif